@@ -3,6 +3,7 @@
 
 #include "Event.hpp"
 #include "Graphics.hpp"
+#include "RenderQueue.hpp"
 
 namespace App
 {
@@ -28,7 +29,8 @@ namespace App
         inline auto operator=(const Application &) = delete;
         inline auto operator=(Application &&) = delete;
 
-        Application(const char *name = "Application", Args args = Args{}) : window(name, 640, 480), args(args)
+        Application(const char *name = "Application", Args args = Args{}, Graphics::Platform platform = Graphics::DEFAULT_PLATFORM)
+            : window(name, 640, 480, platform), args(args)
         {
             ASSERT(!instance, "Application instance already exists!");
             window.set_event_callback(std::bind(&Application::on_event, this, std::placeholders::_1));
@@ -66,6 +68,40 @@ namespace App
             return window;
         }
 
+        inline auto get_layer_stack() -> Event::LayerStack &
+        {
+            return layer_stack;
+        }
+
+        // Moves rendering to a render thread: from now on layers record commands into get_render_queue().commands().
+        inline auto enable_render_queue(std::unique_ptr<Graphics::Render::CommandExecutor> executor) -> void
+        {
+            render_queue = std::make_unique<Graphics::Render::RenderQueue>(window, std::move(executor));
+        }
+
+        inline auto has_render_queue() const -> bool
+        {
+            return render_queue != nullptr;
+        }
+
+        // Layers skip rendering and only advance the simulation on AppTick, e.g. for load tests on a headless window.
+        inline auto set_simulation_only(bool value) -> Application &
+        {
+            simulation_only = value;
+            return *this;
+        }
+
+        inline auto is_simulation_only() const -> bool
+        {
+            return simulation_only;
+        }
+
+        inline auto get_render_queue() -> Graphics::Render::RenderQueue &
+        {
+            ASSERT(render_queue, "Render queue is not enabled");
+            return *render_queue;
+        }
+
         inline auto push_layer(Event::AbstractLayer *layer) -> void
         {
             layer_stack.push(layer);
@@ -83,9 +119,14 @@ namespace App
 
         inline auto run() -> void
         {
+            PROFILE_THREAD_NAME("Main");
             while (running)
             {
+                ALLOC_NEXT_FRAME();
                 window.on_update();
+
+                if (render_queue)
+                    render_queue->submit();
             }
         }
 
@@ -93,8 +134,11 @@ namespace App
         Graphics::Window window;
         Args args;
 
+        // Declared after the window: the render thread has to stop before the window goes away.
+        std::unique_ptr<Graphics::Render::RenderQueue> render_queue;
+
     private:
-        bool running{true};
+        bool running{true}, simulation_only{false};
         Event::LayerStack layer_stack;
 
         static Application *instance;
@@ -0,0 +1,296 @@
+#ifndef BINARY_LOG_HPP
+#define BINARY_LOG_HPP
+
+#include "Error.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/*
+Deferred formatting: a call site records the id of its (static) format string and the raw bytes of its arguments.
+Turning records back into text is the job of tools/LogDecoder.cpp.
+
+File layout (native byte order):
+    Header:     magic[8], uint64 steady clock ns at open, int64 system clock ns at open
+    Format:     uint8 RecordKind::Format, uint32 id, uint32 line, uint16 format length, uint16 file length, format, file
+    Entry:      uint8 RecordKind::Entry, uint32 id, uint64 steady clock ns, uint16 payload size, payload
+    Payload:    sequence of uint8 ArgTag followed by the value (strings are uint16 length + bytes)
+*/
+
+// Binary counterpart of LOG_AT: the format string is registered once per call site, the arguments are copied raw.
+#define BLOG(logger, fmt, ...)                                                                                   \
+    do                                                                                                           \
+    {                                                                                                            \
+        if ((logger).is_active())                                                                                \
+        {                                                                                                        \
+            static const uint32_t _blog_format_id = Log::Binary::register_format(fmt, __FILE__, __LINE__);      \
+            (logger).log(_blog_format_id __VA_OPT__(, ) __VA_ARGS__);                                            \
+        }                                                                                                        \
+    } while (false)
+
+namespace Log::Binary
+{
+    constexpr char MAGIC[8] = {'A', 'S', 'T', 'B', 'L', 'O', 'G', '1'};
+
+    enum class RecordKind : uint8_t
+    {
+        Format = 1,
+        Entry = 2
+    };
+
+    enum class ArgTag : uint8_t
+    {
+        Int = 1,
+        Unsigned = 2,
+        Double = 3,
+        String = 4,
+        Pointer = 5
+    };
+
+    struct FormatInfo
+    {
+        const char *format;
+        const char *file;
+        uint32_t line;
+    };
+
+    // Every format string registered by a BLOG call site, indexed by id.
+    inline auto format_registry() -> std::vector<FormatInfo> &
+    {
+        static std::vector<FormatInfo> registry;
+        return registry;
+    }
+
+    inline auto format_registry_mutex() -> std::mutex &
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    // Runs once per call site, not per call.
+    inline auto register_format(const char *format, const char *file, uint32_t line) -> uint32_t
+    {
+        std::lock_guard lock(format_registry_mutex());
+
+        auto &registry = format_registry();
+        registry.push_back({format, file, line});
+        return static_cast<uint32_t>(registry.size() - 1);
+    }
+
+    namespace _impl
+    {
+        template <typename T>
+        inline auto put(char *&out, const T &value) -> void
+        {
+            std::memcpy(out, &value, sizeof(T));
+            out += sizeof(T);
+        }
+
+        inline auto string_arg(const char *str) -> std::string_view
+        {
+            return str ? std::string_view(str) : std::string_view("(null)");
+        }
+
+        // Strings longer than this are truncated.
+        constexpr size_t MAX_STRING_ARG = 4096;
+
+        // Largest format record: header, then format string and file name of up to MAX_STRING_ARG each.
+        constexpr size_t MAX_FORMAT_RECORD = 1 + 2 * sizeof(uint32_t) + 2 * sizeof(uint16_t) + 2 * MAX_STRING_ARG;
+
+        template <typename T>
+        inline auto encoded_size(const T &value) -> size_t
+        {
+            using U = std::decay_t<T>;
+            if constexpr (std::is_same_v<U, char *> || std::is_same_v<U, const char *>)
+                return 1 + sizeof(uint16_t) + std::min(string_arg(value).size(), MAX_STRING_ARG);
+            else if constexpr (std::is_convertible_v<const U &, std::string_view>)
+                return 1 + sizeof(uint16_t) + std::min(std::string_view(value).size(), MAX_STRING_ARG);
+            else
+                return 1 + sizeof(uint64_t);
+        }
+
+        template <typename T>
+        inline auto encode(char *&out, const T &value) -> void
+        {
+            using U = std::decay_t<T>;
+            if constexpr (std::is_same_v<U, char *> || std::is_same_v<U, const char *> || std::is_convertible_v<const U &, std::string_view>)
+            {
+                std::string_view str;
+                if constexpr (std::is_same_v<U, char *> || std::is_same_v<U, const char *>)
+                    str = string_arg(value);
+                else
+                    str = value;
+
+                const auto length = static_cast<uint16_t>(std::min(str.size(), MAX_STRING_ARG));
+                put(out, ArgTag::String);
+                put(out, length);
+                std::memcpy(out, str.data(), length);
+                out += length;
+            }
+            else if constexpr (std::is_floating_point_v<U>)
+            {
+                put(out, ArgTag::Double);
+                put(out, static_cast<double>(value));
+            }
+            else if constexpr (std::is_enum_v<U>)
+            {
+                put(out, ArgTag::Int);
+                put(out, static_cast<int64_t>(value));
+            }
+            else if constexpr (std::is_pointer_v<U>)
+            {
+                put(out, ArgTag::Pointer);
+                put(out, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value)));
+            }
+            else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>)
+            {
+                put(out, ArgTag::Int);
+                put(out, static_cast<int64_t>(value));
+            }
+            else
+            {
+                static_assert(std::is_integral_v<U>, "Unsupported BLOG argument type");
+                put(out, ArgTag::Unsigned);
+                put(out, static_cast<uint64_t>(value));
+            }
+        }
+    }
+
+    // Buffers records in memory and writes them to a file in large chunks. Not thread-safe: use one per thread.
+    // The buffer always fits the largest format record; entries that do not fit it are dropped.
+    class BinaryLogger
+    {
+    public:
+        BinaryLogger(const char *path, size_t buffer_size = 1 << 20) : buffer(std::max(buffer_size, _impl::MAX_FORMAT_RECORD))
+        {
+            file = std::fopen(path, "wb");
+            SOFT_ASSERT(file, "Could not open binary log file, binary logging is disabled");
+
+            if (not file)
+                return;
+
+            const auto steady = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            const auto system = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+            std::fwrite(MAGIC, sizeof(MAGIC), 1, file);
+            std::fwrite(&steady, sizeof(uint64_t), 1, file);
+            std::fwrite(&system, sizeof(int64_t), 1, file);
+        }
+
+        BinaryLogger(const BinaryLogger &) = delete;
+        BinaryLogger(BinaryLogger &&) = delete;
+        inline auto operator=(const BinaryLogger &) = delete;
+        inline auto operator=(BinaryLogger &&) = delete;
+
+        ~BinaryLogger()
+        {
+            if (file)
+            {
+                flush();
+                std::fclose(file);
+            }
+        }
+
+        inline auto is_active() const -> bool
+        {
+            return enabled && file;
+        }
+
+        inline auto set_enabled(bool value) -> BinaryLogger &
+        {
+            enabled = value;
+            return *this;
+        }
+
+        template <typename... Ts>
+        inline auto log(uint32_t format_id, const Ts &...args) -> void
+        {
+            if (format_id >= formats_written) [[unlikely]]
+                write_formats();
+
+            const size_t payload = (size_t{0} + ... + _impl::encoded_size(args));
+            if (payload > UINT16_MAX) [[unlikely]]
+                return;
+
+            const size_t size = 1 + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint16_t) + payload;
+
+            if (used + size > buffer.size()) [[unlikely]]
+            {
+                flush();
+                if (size > buffer.size())
+                    return;
+            }
+
+            const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+            char *out = buffer.data() + used;
+            _impl::put(out, RecordKind::Entry);
+            _impl::put(out, format_id);
+            _impl::put(out, static_cast<uint64_t>(now));
+            _impl::put(out, static_cast<uint16_t>(payload));
+            (_impl::encode(out, args), ...);
+
+            used += size;
+        }
+
+        inline auto flush() -> void
+        {
+            // Without a file, fflush(nullptr) would flush every stream of the process.
+            if (not file)
+                return;
+
+            if (used)
+            {
+                std::fwrite(buffer.data(), 1, used, file);
+                used = 0;
+            }
+            std::fflush(file);
+        }
+
+    private:
+        // Format definitions always precede the first entry that refers to them.
+        inline auto write_formats() -> void
+        {
+            std::lock_guard lock(format_registry_mutex());
+            const auto &registry = format_registry();
+
+            for (; formats_written < registry.size(); formats_written++)
+            {
+                const auto &info = registry[formats_written];
+                const auto format_length = static_cast<uint16_t>(std::min(std::strlen(info.format), _impl::MAX_STRING_ARG));
+                const auto file_length = static_cast<uint16_t>(std::min(std::strlen(info.file), _impl::MAX_STRING_ARG));
+                const size_t size = 1 + 2 * sizeof(uint32_t) + 2 * sizeof(uint16_t) + format_length + file_length;
+
+                if (used + size > buffer.size())
+                    flush();
+
+                char *out = buffer.data() + used;
+                _impl::put(out, RecordKind::Format);
+                _impl::put(out, static_cast<uint32_t>(formats_written));
+                _impl::put(out, info.line);
+                _impl::put(out, format_length);
+                _impl::put(out, file_length);
+                std::memcpy(out, info.format, format_length);
+                std::memcpy(out + format_length, info.file, file_length);
+
+                used += size;
+            }
+        }
+
+        std::FILE *file{nullptr};
+        bool enabled{true};
+
+        std::vector<char> buffer;
+        size_t used{0};
+        size_t formats_written{0};
+    };
+}
+
+#endif
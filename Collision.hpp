@@ -0,0 +1,581 @@
+#ifndef COLLISION_HPP
+#define COLLISION_HPP
+
+#include "Error.hpp"
+#include "Graphics.hpp"
+#include "Profile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+Collision detection between convex outlines (asteroids, the ship), segments and points (bullets).
+
+A UniformGrid (broad phase) finds candidate pairs of bodies that are close to each other. The NarrowPhase then rejects
+the pairs whose bounding circles do not overlap, and runs a separating axis test on the rest. Both stages work on
+structure-of-arrays batches and test four pairs at a time with SSE2 (scalar elsewhere). Overlapping pairs end up in a
+contact buffer that is reused from frame to frame.
+*/
+
+namespace Collision
+{
+    // Outlines with more vertices have to be split.
+    constexpr size_t MAX_VERTICES = 16;
+
+    using ShapeID = uint32_t;
+    using BodyID = uint32_t;
+
+    // `normal` points from body a to body b; moving b by normal * depth separates them.
+    struct Contact
+    {
+        BodyID a, b;
+        Graphics::Vec2 normal;
+        float depth;
+    };
+
+    /*
+    Buckets bodies by the cell their center falls into. Cells should be at least as large as the largest body, so
+    that the 3x3 cells around a body hold every body that can touch it. Memory is kept between frames.
+    */
+    class UniformGrid
+    {
+    public:
+        // Forgets every body and covers [min_x, max_x] x [min_y, max_y]. Positions outside are clamped to the border.
+        inline auto reset(float min_x, float min_y, float max_x, float max_y, float cell_size) -> void
+        {
+            this->min_x = min_x;
+            this->min_y = min_y;
+            inv_cell = 1.0f / cell_size;
+            columns = std::max<size_t>(1, static_cast<size_t>(std::ceil((max_x - min_x) * inv_cell)));
+            rows = std::max<size_t>(1, static_cast<size_t>(std::ceil((max_y - min_y) * inv_cell)));
+
+            cell_begin.assign(columns * rows + 1, 0);
+            entries.clear();
+            sorted.clear();
+        }
+
+        inline auto reserve(size_t bodies) -> void
+        {
+            entries.reserve(bodies);
+            sorted.reserve(bodies);
+        }
+
+        inline auto insert(BodyID body, float x, float y) -> void
+        {
+            entries.push_back({body, cell_of(x, y)});
+        }
+
+        // Sorts the inserted bodies by cell (a counting sort). Call once after the last insert.
+        inline auto build() -> void
+        {
+            PROFILE_SCOPE("UniformGrid::build");
+
+            for (const auto &entry : entries)
+                cell_begin[entry.cell + 1]++;
+            for (size_t i = 1; i < cell_begin.size(); i++)
+                cell_begin[i] += cell_begin[i - 1];
+
+            sorted.resize(entries.size());
+            cursor.assign(cell_begin.begin(), cell_begin.end() - 1);
+            for (const auto &entry : entries)
+                sorted[cursor[entry.cell]++] = entry.body;
+        }
+
+        // Calls function(body) for every body in the 3x3 cells around (x, y).
+        template <typename F>
+        inline auto query(float x, float y, F function) const -> void
+        {
+            const size_t cell = cell_of(x, y);
+            const size_t column = cell % columns, row = cell / columns;
+
+            for (size_t r = row ? row - 1 : 0; r <= std::min(row + 1, rows - 1); r++)
+            {
+                for (size_t c = column ? column - 1 : 0; c <= std::min(column + 1, columns - 1); c++)
+                {
+                    const size_t index = r * columns + c;
+                    for (uint32_t i = cell_begin[index]; i < cell_begin[index + 1]; i++)
+                        function(sorted[i]);
+                }
+            }
+        }
+
+    private:
+        struct Entry
+        {
+            BodyID body;
+            uint32_t cell;
+        };
+
+        inline auto cell_of(float x, float y) const -> uint32_t
+        {
+            const auto clamp = [](float value, size_t count) -> size_t
+            {
+                return value <= 0.0f ? 0 : std::min(static_cast<size_t>(value), count - 1);
+            };
+
+            return static_cast<uint32_t>(clamp((y - min_y) * inv_cell, rows) * columns + clamp((x - min_x) * inv_cell, columns));
+        }
+
+        float min_x{0.0f}, min_y{0.0f}, inv_cell{1.0f};
+        size_t columns{1}, rows{1};
+
+        std::vector<Entry> entries;
+        std::vector<uint32_t> cell_begin, cursor;
+        std::vector<BodyID> sorted;
+    };
+
+    class NarrowPhase
+    {
+    public:
+        struct Stats
+        {
+            size_t pairs{0};
+            size_t prefiltered{0}; // Pairs whose bounding circles overlap
+            size_t contacts{0};
+        };
+
+        // Registers a convex outline given in model space (either winding). One point is a point, two a segment.
+        inline auto add_shape(const Graphics::Vec2 *points, size_t count) -> ShapeID
+        {
+            ASSERT(count >= 1 && count <= MAX_VERTICES, "Collision shapes need between 1 and MAX_VERTICES vertices");
+
+            Shape shape{};
+            shape.count = count;
+            for (size_t i = 0; i < MAX_VERTICES; i++)
+            {
+                // Padding repeats the last vertex, which changes no projection.
+                const auto &p = points[std::min(i, count - 1)];
+                shape.x[i] = p.x;
+                shape.y[i] = p.y;
+                shape.radius = std::max(shape.radius, std::sqrt(p.x * p.x + p.y * p.y));
+            }
+
+            // Edge normals. Points have none, so they get the coordinate axes; an extra axis never hides an overlap.
+            size_t axes{0};
+            for (size_t i = 0; i < count; i++)
+            {
+                const auto &from = points[i], &to = points[(i + 1) % count];
+                const float nx = to.y - from.y, ny = from.x - to.x;
+                const float length = std::sqrt(nx * nx + ny * ny);
+                if (length > 0.0f)
+                {
+                    shape.nx[axes] = nx / length;
+                    shape.ny[axes] = ny / length;
+                    axes++;
+                }
+            }
+            if (axes == 0)
+            {
+                shape.nx[0] = 1.0f, shape.ny[0] = 0.0f;
+                shape.nx[1] = 0.0f, shape.ny[1] = 1.0f;
+                axes = 2;
+            }
+            for (size_t i = axes; i < MAX_VERTICES; i++)
+            {
+                shape.nx[i] = shape.nx[0];
+                shape.ny[i] = shape.ny[0];
+            }
+            shape.axes = axes;
+
+            shapes.push_back(shape);
+            return static_cast<ShapeID>(shapes.size() - 1);
+        }
+
+        // Switches between the SIMD and the scalar tests, e.g. to compare them. Ignored without SSE2.
+        inline auto set_simd(bool value) -> NarrowPhase &
+        {
+            simd = value;
+            return *this;
+        }
+
+        // Sizes the per-frame buffers up front, so that frames up to these counts do not allocate.
+        inline auto reserve(size_t bodies, size_t pairs) -> void
+        {
+            body_shape.reserve(bodies);
+            body_transform.reserve(bodies);
+            for (auto *array : {&body_cos, &body_sin})
+                array->reserve(bodies);
+            body_rotated.reserve(bodies);
+            pair_a.reserve(pairs);
+            pair_b.reserve(pairs);
+            // The SIMD prefilter pads the pair arrays to a multiple of four.
+            for (auto *array : {&pair_dx, &pair_dy, &pair_radius})
+                array->reserve((pairs + 3) / 4 * 4);
+            survivors.reserve(pairs);
+            contacts.reserve(pairs);
+        }
+
+        // Forgets the bodies, pairs and contacts of the last frame.
+        inline auto begin() -> void
+        {
+            body_shape.clear();
+            body_transform.clear();
+            body_cos.clear();
+            body_sin.clear();
+            body_rotated.clear();
+            pair_a.clear();
+            pair_b.clear();
+            for (auto *array : {&pair_dx, &pair_dy, &pair_radius})
+                array->clear();
+            survivors.clear();
+            contacts.clear();
+            stats = Stats{};
+        }
+
+        // Places a shape in the world for this frame.
+        inline auto add_body(ShapeID shape, const Graphics::Transform2D &transform) -> BodyID
+        {
+            body_shape.push_back(shape);
+            body_transform.push_back(transform);
+            body_cos.push_back(0.0f);
+            body_sin.push_back(0.0f);
+            body_rotated.push_back(0);
+            return static_cast<BodyID>(body_shape.size() - 1);
+        }
+
+        // Queues a candidate pair, e.g. from UniformGrid::query.
+        inline auto add_pair(BodyID a, BodyID b) -> void
+        {
+            const auto &ta = body_transform[a], &tb = body_transform[b];
+            pair_a.push_back(a);
+            pair_b.push_back(b);
+            pair_dx.push_back(tb.x - ta.x);
+            pair_dy.push_back(tb.y - ta.y);
+            pair_radius.push_back(shapes[body_shape[a]].radius * ta.scale + shapes[body_shape[b]].radius * tb.scale);
+        }
+
+        // Tests every queued pair; the overlapping ones are in get_contacts() afterwards.
+        inline auto run() -> const std::vector<Contact> &
+        {
+            PROFILE_SCOPE("NarrowPhase::run");
+            stats.pairs = pair_a.size();
+            survivors.clear();
+            contacts.clear();
+
+#ifdef __SSE2__
+            if (simd)
+                prefilter_simd();
+            else
+#endif
+                prefilter_scalar();
+
+            // Only bodies with a surviving pair need their rotation.
+            std::fill(body_rotated.begin(), body_rotated.end(), 0);
+            for (const auto pair : survivors)
+            {
+                rotate_body(pair_a[pair]);
+                rotate_body(pair_b[pair]);
+            }
+
+#ifdef __SSE2__
+            if (simd)
+                sat_simd();
+            else
+#endif
+                sat_scalar();
+
+            stats.prefiltered = survivors.size();
+            stats.contacts = contacts.size();
+            return contacts;
+        }
+
+        inline auto get_contacts() const -> const std::vector<Contact> &
+        {
+            return contacts;
+        }
+
+        // Counters of the last run.
+        inline auto get_stats() const -> const Stats &
+        {
+            return stats;
+        }
+
+    private:
+        struct Shape
+        {
+            float x[MAX_VERTICES], y[MAX_VERTICES];
+            float nx[MAX_VERTICES], ny[MAX_VERTICES];
+            size_t count, axes;
+            float radius;
+        };
+
+        // Shapes are few and stay in cache, so bodies are transformed to world space on the fly, in registers.
+        // Only the trigonometry is evaluated once per body.
+        inline auto rotate_body(BodyID body) -> void
+        {
+            if (body_rotated[body])
+                return;
+
+            body_cos[body] = std::cos(body_transform[body].rotation);
+            body_sin[body] = std::sin(body_transform[body].rotation);
+            body_rotated[body] = 1;
+        }
+
+        // Flips the normal to point from a to b and records the contact.
+        inline auto add_contact(size_t pair, float nx, float ny, float depth) -> void
+        {
+            if (nx * pair_dx[pair] + ny * pair_dy[pair] < 0.0f)
+                nx = -nx, ny = -ny;
+            contacts.push_back({pair_a[pair], pair_b[pair], {nx, ny}, depth});
+        }
+
+        inline auto prefilter_scalar() -> void
+        {
+            for (size_t i = 0; i < pair_a.size(); i++)
+            {
+                if (pair_dx[i] * pair_dx[i] + pair_dy[i] * pair_dy[i] <= pair_radius[i] * pair_radius[i])
+                    survivors.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        // A body's vertices and edge normals in world space.
+        struct Placed
+        {
+            float x[MAX_VERTICES], y[MAX_VERTICES];
+            float nx[MAX_VERTICES], ny[MAX_VERTICES];
+            size_t count, axes;
+        };
+
+        inline auto place(BodyID body, Placed &out) const -> void
+        {
+            const auto &shape = shapes[body_shape[body]];
+            const auto &t = body_transform[body];
+            const float cos = body_cos[body], sin = body_sin[body];
+
+            out.count = shape.count;
+            out.axes = shape.axes;
+            for (size_t i = 0; i < shape.count; i++)
+            {
+                out.x[i] = t.x + t.scale * (cos * shape.x[i] - sin * shape.y[i]);
+                out.y[i] = t.y + t.scale * (sin * shape.x[i] + cos * shape.y[i]);
+            }
+            for (size_t i = 0; i < shape.axes; i++)
+            {
+                out.nx[i] = cos * shape.nx[i] - sin * shape.ny[i];
+                out.ny[i] = sin * shape.nx[i] + cos * shape.ny[i];
+            }
+        }
+
+        // Minimum overlap of the projections of a and b onto the axes of `axes`; false if one of them separates them.
+        static inline auto min_overlap(const Placed &a, const Placed &b, const Placed &axes, float &best, float &best_x, float &best_y) -> bool
+        {
+            for (size_t k = 0; k < axes.axes; k++)
+            {
+                const float nx = axes.nx[k], ny = axes.ny[k];
+
+                float min_a = std::numeric_limits<float>::max(), max_a = -min_a, min_b = min_a, max_b = -min_a;
+                for (size_t v = 0; v < a.count; v++)
+                {
+                    const float p = a.x[v] * nx + a.y[v] * ny;
+                    min_a = std::min(min_a, p), max_a = std::max(max_a, p);
+                }
+                for (size_t v = 0; v < b.count; v++)
+                {
+                    const float p = b.x[v] * nx + b.y[v] * ny;
+                    min_b = std::min(min_b, p), max_b = std::max(max_b, p);
+                }
+
+                const float overlap = std::min(max_a, max_b) - std::max(min_a, min_b);
+                if (overlap < 0.0f)
+                    return false;
+                if (overlap < best)
+                    best = overlap, best_x = nx, best_y = ny;
+            }
+            return true;
+        }
+
+        // The reference implementation: one pair at a time, with the shapes' real vertex and axis counts.
+        inline auto sat_scalar() -> void
+        {
+            Placed a, b;
+            for (const auto pair : survivors)
+            {
+                place(pair_a[pair], a);
+                place(pair_b[pair], b);
+
+                float depth = std::numeric_limits<float>::max(), nx{0.0f}, ny{0.0f};
+                if (min_overlap(a, b, a, depth, nx, ny) && min_overlap(a, b, b, depth, nx, ny))
+                    add_contact(pair, nx, ny, depth);
+            }
+        }
+
+#ifdef __SSE2__
+        static inline auto select(__m128 mask, __m128 a, __m128 b) -> __m128
+        {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }
+
+        // Four pairs per step. The tail is padded with pairs that cannot pass.
+        inline auto prefilter_simd() -> void
+        {
+            const size_t count = pair_a.size();
+            for (auto *array : {&pair_dx, &pair_dy})
+                array->resize((count + 3) / 4 * 4, std::numeric_limits<float>::max());
+            pair_radius.resize((count + 3) / 4 * 4, 0.0f);
+
+            for (size_t i = 0; i < count; i += 4)
+            {
+                const __m128 dx = _mm_loadu_ps(pair_dx.data() + i), dy = _mm_loadu_ps(pair_dy.data() + i);
+                const __m128 r = _mm_loadu_ps(pair_radius.data() + i);
+                const int hits = _mm_movemask_ps(_mm_cmple_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(r, r)));
+
+                for (int lane = 0; hits >> lane; lane++)
+                {
+                    if (hits & (1 << lane))
+                        survivors.push_back(static_cast<uint32_t>(i + lane));
+                }
+            }
+
+            pair_dx.resize(count);
+            pair_dy.resize(count);
+            pair_radius.resize(count);
+        }
+
+        // One side (a or b) of four pairs, transposed so that every lane is one pair.
+        struct Lanes
+        {
+            __m128 x[MAX_VERTICES], y[MAX_VERTICES];
+            __m128 nx[MAX_VERTICES], ny[MAX_VERTICES];
+            size_t count{1}, axes{1}; // Largest of the four
+        };
+
+        // Transforms the bodies' shapes into world space, four at a time. Lanes run to the largest vertex and axis
+        // count of the four; the padding of the shapes makes the extra entries harmless.
+        inline auto place_simd(const BodyID *bodies, Lanes &out) const -> void
+        {
+            const Shape *s[4];
+            float c[4], sn[4], scale[4], tx[4], ty[4];
+            for (size_t lane = 0; lane < 4; lane++)
+            {
+                const BodyID body = bodies[lane];
+                const auto &t = body_transform[body];
+                s[lane] = &shapes[body_shape[body]];
+                c[lane] = body_cos[body], sn[lane] = body_sin[body];
+                scale[lane] = t.scale, tx[lane] = t.x, ty[lane] = t.y;
+                out.count = std::max(out.count, s[lane]->count);
+                out.axes = std::max(out.axes, s[lane]->axes);
+            }
+
+            const __m128 cos = _mm_loadu_ps(c), sin = _mm_loadu_ps(sn), size = _mm_loadu_ps(scale);
+            const __m128 x = _mm_loadu_ps(tx), y = _mm_loadu_ps(ty);
+            for (size_t v = 0; v < out.count; v++)
+            {
+                const __m128 mx = _mm_setr_ps(s[0]->x[v], s[1]->x[v], s[2]->x[v], s[3]->x[v]);
+                const __m128 my = _mm_setr_ps(s[0]->y[v], s[1]->y[v], s[2]->y[v], s[3]->y[v]);
+                out.x[v] = _mm_add_ps(x, _mm_mul_ps(size, _mm_sub_ps(_mm_mul_ps(cos, mx), _mm_mul_ps(sin, my))));
+                out.y[v] = _mm_add_ps(y, _mm_mul_ps(size, _mm_add_ps(_mm_mul_ps(sin, mx), _mm_mul_ps(cos, my))));
+            }
+            for (size_t k = 0; k < out.axes; k++)
+            {
+                const __m128 mx = _mm_setr_ps(s[0]->nx[k], s[1]->nx[k], s[2]->nx[k], s[3]->nx[k]);
+                const __m128 my = _mm_setr_ps(s[0]->ny[k], s[1]->ny[k], s[2]->ny[k], s[3]->ny[k]);
+                out.nx[k] = _mm_sub_ps(_mm_mul_ps(cos, mx), _mm_mul_ps(sin, my));
+                out.ny[k] = _mm_add_ps(_mm_mul_ps(sin, mx), _mm_mul_ps(cos, my));
+            }
+        }
+
+        // Projects a and b onto the axes of `axes` (a or b), four pairs at a time.
+        static inline auto min_overlap_simd(const Lanes &a, const Lanes &b, const Lanes &axes, __m128 &separated, __m128 &best,
+                                            __m128 &best_x, __m128 &best_y) -> void
+        {
+            const __m128 zero = _mm_setzero_ps();
+            for (size_t k = 0; k < axes.axes; k++)
+            {
+                const __m128 nx = axes.nx[k], ny = axes.ny[k];
+
+                __m128 min_a = _mm_add_ps(_mm_mul_ps(a.x[0], nx), _mm_mul_ps(a.y[0], ny)), max_a = min_a;
+                for (size_t v = 1; v < a.count; v++)
+                {
+                    const __m128 p = _mm_add_ps(_mm_mul_ps(a.x[v], nx), _mm_mul_ps(a.y[v], ny));
+                    min_a = _mm_min_ps(min_a, p), max_a = _mm_max_ps(max_a, p);
+                }
+
+                __m128 min_b = _mm_add_ps(_mm_mul_ps(b.x[0], nx), _mm_mul_ps(b.y[0], ny)), max_b = min_b;
+                for (size_t v = 1; v < b.count; v++)
+                {
+                    const __m128 p = _mm_add_ps(_mm_mul_ps(b.x[v], nx), _mm_mul_ps(b.y[v], ny));
+                    min_b = _mm_min_ps(min_b, p), max_b = _mm_max_ps(max_b, p);
+                }
+
+                const __m128 overlap = _mm_sub_ps(_mm_min_ps(max_a, max_b), _mm_max_ps(min_a, min_b));
+                separated = _mm_or_ps(separated, _mm_cmplt_ps(overlap, zero));
+
+                const __m128 better = _mm_cmplt_ps(overlap, best);
+                best = select(better, overlap, best);
+                best_x = select(better, nx, best_x);
+                best_y = select(better, ny, best_y);
+
+                if (_mm_movemask_ps(separated) == 0xF)
+                    return;
+            }
+        }
+
+        // Four surviving pairs per step; a short tail repeats its last pair.
+        inline auto sat_simd() -> void
+        {
+            Lanes a, b;
+            for (size_t i = 0; i < survivors.size(); i += 4)
+            {
+                const size_t lanes = std::min<size_t>(4, survivors.size() - i);
+                size_t pairs[4];
+                BodyID bodies_a[4], bodies_b[4];
+                for (size_t lane = 0; lane < 4; lane++)
+                {
+                    pairs[lane] = survivors[i + std::min(lane, lanes - 1)];
+                    bodies_a[lane] = pair_a[pairs[lane]];
+                    bodies_b[lane] = pair_b[pairs[lane]];
+                }
+
+                a.count = a.axes = b.count = b.axes = 1;
+                place_simd(bodies_a, a);
+                place_simd(bodies_b, b);
+
+                __m128 separated = _mm_setzero_ps(), best = _mm_set1_ps(std::numeric_limits<float>::max());
+                __m128 best_x = _mm_setzero_ps(), best_y = _mm_setzero_ps();
+                min_overlap_simd(a, b, a, separated, best, best_x, best_y);
+                if (_mm_movemask_ps(separated) != 0xF)
+                    min_overlap_simd(a, b, b, separated, best, best_x, best_y);
+
+                const int hits = ~_mm_movemask_ps(separated) & ((1 << lanes) - 1);
+                if (not hits)
+                    continue;
+
+                float depth[4], nx[4], ny[4];
+                _mm_storeu_ps(depth, best);
+                _mm_storeu_ps(nx, best_x);
+                _mm_storeu_ps(ny, best_y);
+                for (size_t lane = 0; lane < lanes; lane++)
+                {
+                    if (hits & (1 << lane))
+                        add_contact(pairs[lane], nx[lane], ny[lane], depth[lane]);
+                }
+            }
+        }
+#endif
+
+        std::vector<Shape> shapes;
+        bool simd{true};
+
+        std::vector<ShapeID> body_shape;
+        std::vector<Graphics::Transform2D> body_transform;
+        std::vector<float> body_cos, body_sin;
+        std::vector<uint8_t> body_rotated;
+
+        std::vector<BodyID> pair_a, pair_b;
+        std::vector<float> pair_dx, pair_dy, pair_radius;
+        std::vector<uint32_t> survivors;
+
+        std::vector<Contact> contacts;
+        Stats stats;
+    };
+}
+
+#endif
@@ -2,10 +2,13 @@
 #define ECS_HPP
 
 #include "Error.hpp"
+#include "Profile.hpp"
 
 #include <vector>
 #include <iostream>
+#include <algorithm>
 #include <array>
+#include <cstdint>
 #include <tuple>
 
 /*
@@ -27,6 +30,9 @@ namespace ECS
     class Scene;
     class Entity;
 
+    template <typename... Ts>
+    class Prefab;
+
     namespace _impl
     {
         class AbstractComponentPool;
@@ -105,6 +111,29 @@ namespace ECS
                 return component_array.back();
             }
 
+            // Gives each of the `count` entities a copy of `value`, appended to the arrays as one block.
+            inline auto emplace_copies(const EntityIndex *entity_indices, size_t count, const T &value) -> void
+            {
+                if (count == 0)
+                    return;
+
+                const EntityIndex highest = *std::max_element(entity_indices, entity_indices + count);
+                if (sparse_array.size() <= highest)
+                {
+                    sparse_array.resize(highest + 1, _impl::INVALID_INDEX);
+                }
+
+                const size_t first = dense_array.size();
+                for (size_t i = 0; i < count; i++)
+                {
+                    ASSERT(not contains(entity_indices[i]), "Tried to emplace to already occupied slot");
+                    sparse_array[entity_indices[i]] = first + i;
+                }
+
+                dense_array.insert(dense_array.end(), entity_indices, entity_indices + count);
+                component_array.insert(component_array.end(), count, value);
+            }
+
             virtual inline auto reserve(size_t amount) -> void override
             {
                 sparse_array.reserve(amount);
@@ -190,11 +219,13 @@ namespace ECS
         template <typename T>
         inline auto reserve_component(size_t amount) -> void
         {
+            PROFILE_SCOPE("Scene::reserve_component");
             assure_component_pool<T>().reserve(amount);
         }
 
         inline auto reserve_entity(size_t amount) -> void
         {
+            PROFILE_SCOPE("Scene::reserve_entity");
             entities.reserve(amount);
         }
 
@@ -261,6 +292,7 @@ namespace ECS
 
         inline auto destroy(EntityID entity_id) -> void
         {
+            activate(entity_id);
             entities[_impl::index_of(entity_id)] = _impl::make_id(_impl::INVALID_INDEX, _impl::version_of(entity_id) + 1);
             free_entities.push_back(_impl::index_of(entity_id));
 
@@ -275,16 +307,29 @@ namespace ECS
         inline auto for_each_component(F function) const -> void
         {
             ASSERT(valid_component_pool(_impl::component_id<T>()), "Tried to access invalid component pool");
+            PROFILE_SCOPE("Scene::for_each_component");
 
             auto pool = reinterpret_cast<_impl::ComponentPool<T> *>(component_pools[_impl::component_id<T>()]);
-            for (auto itr = pool->component_array.begin(); itr != pool->component_array.end(); ++itr)
-                function(*itr);
+            if (inactive_entities == 0)
+            {
+                for (auto itr = pool->component_array.begin(); itr != pool->component_array.end(); ++itr)
+                    function(*itr);
+            }
+            else
+            {
+                for (size_t i = 0; i < pool->component_array.size(); i++)
+                {
+                    if (not is_inactive(pool->dense_array[i]))
+                        function(pool->component_array[i]);
+                }
+            }
         }
 
         template <typename F>
         inline auto for_each_entity(F function) -> void
         {
-            if (free_entities.empty())
+            PROFILE_SCOPE("Scene::for_each_entity");
+            if (free_entities.empty() && inactive_entities == 0)
             {
                 for (auto entity_id : entities)
                     function(this, entity_id);
@@ -293,17 +338,81 @@ namespace ECS
             {
                 for (auto entity_id : entities)
                 {
-                    if (_impl::valid_id(entity_id))
+                    if (_impl::valid_id(entity_id) && not is_inactive(_impl::index_of(entity_id)))
                         function(this, entity_id);
                 }
             }
         }
 
+        // Including inactive entities.
         inline auto entity_count() const -> size_t
         {
             return entities.size() - free_entities.size();
         }
 
+        // Inactive entities keep their id and components, but views and for_each_* skip them until they are
+        // activated again. Cheaper than destroying and recreating them, see Prefab.
+        inline auto deactivate(EntityID entity_id) -> void
+        {
+            const auto index = _impl::index_of(entity_id);
+            if (inactive.size() <= index)
+            {
+                inactive.resize(index + 1, 0);
+            }
+
+            if (not inactive[index])
+            {
+                inactive[index] = 1;
+                inactive_entities++;
+            }
+        }
+
+        inline auto activate(EntityID entity_id) -> void
+        {
+            const auto index = _impl::index_of(entity_id);
+            if (is_inactive(index))
+            {
+                inactive[index] = 0;
+                inactive_entities--;
+            }
+        }
+
+        inline auto is_active(EntityID entity_id) const -> bool
+        {
+            return exists(entity_id) && not is_inactive(_impl::index_of(entity_id));
+        }
+
+        inline auto inactive_count() const -> size_t
+        {
+            return inactive_entities;
+        }
+
+        // Creates an entity with a copy of each of the prefab's components.
+        template <typename... Ts>
+        inline auto instantiate(const Prefab<Ts...> &prefab) -> EntityID
+        {
+            EntityID entity_id;
+            instantiate(prefab, &entity_id, 1);
+            return entity_id;
+        }
+
+        // Creates `count` entities from the prefab, written to `out`. Each component is block-copied into its pool
+        // once for all of them, instead of one assign per entity and component.
+        template <typename... Ts>
+        inline auto instantiate(const Prefab<Ts...> &prefab, EntityID *out, size_t count) -> void
+        {
+            PROFILE_SCOPE("Scene::instantiate");
+
+            scratch_indices.clear();
+            for (size_t i = 0; i < count; i++)
+            {
+                out[i] = create();
+                scratch_indices.push_back(_impl::index_of(out[i]));
+            }
+
+            (assure_component_pool<Ts>().emplace_copies(scratch_indices.data(), count, std::get<Ts>(prefab.get_defaults())), ...);
+        }
+
         template <typename T>
         inline auto component_count() const -> size_t
         {
@@ -321,6 +430,11 @@ namespace ECS
         }
 
     private:
+        inline auto is_inactive(EntityIndex index) const -> bool
+        {
+            return inactive_entities && inactive.size() > index && inactive[index];
+        }
+
         inline auto valid_component_pool(size_t component_id) const -> bool
         {
             return component_pools.size() > component_id && component_pools[component_id] != nullptr;
@@ -345,11 +459,92 @@ namespace ECS
         std::vector<_impl::AbstractComponentPool *> component_pools;
         std::vector<EntityID> entities;
         std::vector<EntityIndex> free_entities;
+        std::vector<uint8_t> inactive;
+        size_t inactive_entities{0};
+        std::vector<EntityIndex> scratch_indices;
 
         template <typename... Ts>
         friend class _impl::SceneView;
     };
 
+    /*
+    A bundle of components with default values, for entities that are created in large numbers (bullets, fragments).
+    Scene::instantiate block-copies the bundle into the pools. With recycling enabled, release() only deactivates an
+    entity and the next spawn() resets its components to the defaults and activates it again, so the churn of short
+    lived entities touches neither the free list nor the pools. Components assigned to a spawned entity on top of the
+    bundle are kept while it is recycled.
+    */
+    template <typename... Ts>
+    class Prefab
+    {
+    public:
+        Prefab(Ts... defaults) : defaults(std::move(defaults)...) {}
+
+        template <typename T>
+        inline auto get() -> T &
+        {
+            return std::get<T>(defaults);
+        }
+
+        inline auto get_defaults() const -> const std::tuple<Ts...> &
+        {
+            return defaults;
+        }
+
+        inline auto set_recycling(bool value) -> Prefab &
+        {
+            recycling = value;
+            return *this;
+        }
+
+        // Reuses a released entity if there is one, instantiates a new one otherwise.
+        inline auto spawn(Scene &scene) -> EntityID
+        {
+            if (recycled.empty())
+                return scene.instantiate(*this);
+
+            const EntityID entity_id = recycled.back();
+            recycled.pop_back();
+
+            ((scene.get<Ts>(entity_id) = std::get<Ts>(defaults)), ...);
+            scene.activate(entity_id);
+            return entity_id;
+        }
+
+        // Deactivates the entity for a later spawn() when recycling, destroys it otherwise.
+        inline auto release(Scene &scene, EntityID entity_id) -> void
+        {
+            if (not recycling)
+            {
+                scene.destroy(entity_id);
+                return;
+            }
+
+            scene.deactivate(entity_id);
+            recycled.push_back(entity_id);
+        }
+
+        // Pre-creates `count` inactive entities, so the first spawns do not allocate either.
+        inline auto reserve(Scene &scene, size_t count) -> void
+        {
+            const size_t first = recycled.size();
+            recycled.resize(first + count);
+            scene.instantiate(*this, recycled.data() + first, count);
+            for (size_t i = first; i < recycled.size(); i++)
+                scene.deactivate(recycled[i]);
+        }
+
+        inline auto get_recycled_count() const -> size_t
+        {
+            return recycled.size();
+        }
+
+    private:
+        std::tuple<Ts...> defaults;
+        bool recycling{false};
+        std::vector<EntityID> recycled;
+    };
+
     class Entity
     {
 
@@ -490,7 +685,8 @@ namespace ECS
                         }
                     }
 
-                    if (sizeof...(Ts) == 0 || _impl::index_of(scene->entities[(*indexes_to_iterate)[index]]) == _impl::INVALID_INDEX)
+                    // A missing or empty pool leaves nothing to iterate.
+                    if (sizeof...(Ts) == 0 || index == _impl::INVALID_INDEX || _impl::index_of(scene->entities[(*indexes_to_iterate)[index]]) == _impl::INVALID_INDEX)
                     {
                         index = _impl::INVALID_INDEX;
                     }
@@ -534,13 +730,13 @@ namespace ECS
                         if (not scene->component_pools[component_id]->contains((*indexes_to_iterate)[index]) || _impl::index_of(scene->entities[(*indexes_to_iterate)[index]]) == _impl::INVALID_INDEX)
                             return true;
                     }
-                    return false;
+                    return scene->is_inactive((*indexes_to_iterate)[index]);
                 }
 
             private:
                 Scene *scene;
                 EntityIndex index;
-                std::vector<EntityIndex> *indexes_to_iterate;
+                std::vector<EntityIndex> *indexes_to_iterate{nullptr};
                 std::array<size_t, sizeof...(Ts)> component_ids;
             };
 
@@ -5,18 +5,26 @@
 
 #define ERR_ASSERTION_STR(title, msg) Log::format("%s: %s \n\tIn file: %s \n\tAt line: %u \n\tIn function: %s", title, msg, __FILE__, __LINE__, __PRETTY_FUNCTION__)
 
+#ifndef ERR_SOFT_ASSERT_INTERVAL_MS
+#define ERR_SOFT_ASSERT_INTERVAL_MS 1000
+#endif
+
 #ifndef ERR_NO_CHECKS
 #define ASSERT(pred, msg)                                                                                                                                  \
     if (not(pred))                                                                                                                                         \
     {                                                                                                                                                      \
         Log::error(ERR_ASSERTION_STR("Assertion failed", msg)); \
+        Log::flush();                                           \
         std::abort();                                                                                                                                      \
     }
 
+// A failing SOFT_ASSERT is reported at most once per ERR_SOFT_ASSERT_INTERVAL_MS, repeats in between only bump a counter.
 #define SOFT_ASSERT(pred, msg)                                                                                                                                 \
     if (not(pred))                                                                                                                                             \
     {                                                                                                                                                          \
-        Log::warn(ERR_ASSERTION_STR("Soft assertion failed", msg)); \
+        static Log::CallSiteLimiter _soft_assert_limiter;                                                                                                      \
+        if (const auto _decision = _soft_assert_limiter.hit(ERR_SOFT_ASSERT_INTERVAL_MS * 1'000'000LL); _decision.log)                                        \
+            Log::warn(ERR_ASSERTION_STR("Soft assertion failed", msg) + Log::repeated_suffix(_decision.repeated));                                            \
     }
 #else
 #define ASSERT(...)
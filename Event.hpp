@@ -3,9 +3,19 @@
 
 #include "Error.hpp"
 #include "InputCodes.hpp"
+#include "Memory.hpp"
+#include "Profile.hpp"
 #include <vector>
 #include <unordered_set>
 #include <string>
+#include <algorithm>
+
+#ifdef EVT_PROFILE_LAYERS
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#endif
 
 #define EVT_IMPL_BOILERPLATE(_type, categories, debug_name)                     \
     virtual inline auto type() const->Type override                             \
@@ -41,6 +51,8 @@ namespace Event
 #include "UserEventTypes.def"
 #endif
 
+        // Not an event type, keep it last.
+        Count
     };
 
     enum class Category
@@ -85,16 +97,105 @@ namespace Event
         }
     };
 
+    inline auto type_name(Type type) -> const char *
+    {
+        switch (type)
+        {
+        case Type::None:
+            return "None";
+        case Type::WindowClose:
+            return "WindowClose";
+        case Type::WindowResize:
+            return "WindowResize";
+        case Type::WindowFocus:
+            return "WindowFocus";
+        case Type::WindowLostFocus:
+            return "WindowLostFocus";
+        case Type::WindowMoved:
+            return "WindowMoved";
+        case Type::WindowRedraw:
+            return "WindowRedraw";
+        case Type::AppTick:
+            return "AppTick";
+        case Type::KeyPressed:
+            return "KeyPressed";
+        case Type::KeyReleased:
+            return "KeyReleased";
+        case Type::MouseButtonPressed:
+            return "MouseButtonPressed";
+        case Type::MouseButtonReleased:
+            return "MouseButtonReleased";
+        case Type::MouseMoved:
+            return "MouseMoved";
+        case Type::MouseScrolled:
+            return "MouseScrolled";
+        default:
+            return "UserDefined";
+        }
+    }
+
     class AbstractLayer
     {
     public:
         virtual inline auto on_attach() -> void {}
         virtual inline auto on_detach() -> void {}
         virtual inline auto on_event(const AbstractEvent &event) -> bool = 0;
+        virtual inline auto debug_name() const -> const char * { return "Unnamed layer"; }
 
         virtual ~AbstractLayer(){};
     };
 
+#ifdef EVT_PROFILE_LAYERS
+    // Time spent in on_event calls of one layer for one event type.
+    struct TimingStats
+    {
+        // Bucket i counts samples of [2^(i-1), 2^i) nanoseconds, the last bucket also holds everything above.
+        static constexpr size_t HISTOGRAM_BUCKETS = 32;
+
+        size_t count{0};
+        uint64_t total_ns{0}, max_ns{0};
+        std::array<size_t, HISTOGRAM_BUCKETS> histogram{};
+
+        inline auto record(uint64_t ns) -> void
+        {
+            count++;
+            total_ns += ns;
+            max_ns = std::max(max_ns, ns);
+            histogram[std::min<size_t>(std::bit_width(ns), HISTOGRAM_BUCKETS - 1)]++;
+        }
+
+        inline auto mean_ns() const -> double
+        {
+            return count ? static_cast<double>(total_ns) / count : 0.0;
+        }
+
+        // Upper bound of the histogram bucket the given percentile (0..1) falls into.
+        inline auto percentile_ns(double p) const -> uint64_t
+        {
+            const auto target = static_cast<size_t>(p * count);
+            size_t seen{0};
+            for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+            {
+                seen += histogram[i];
+                if (seen > target)
+                    return std::min(uint64_t{1} << i, max_ns);
+            }
+            return max_ns;
+        }
+    };
+
+    struct LayerProfile
+    {
+        const AbstractLayer *layer;
+        std::array<TimingStats, static_cast<size_t>(Type::Count)> per_type{};
+
+        inline auto get(Type type) const -> const TimingStats &
+        {
+            return per_type[static_cast<size_t>(type)];
+        }
+    };
+#endif
+
     class LayerStack
     {
     public:
@@ -106,6 +207,9 @@ namespace Event
         inline auto push(AbstractLayer *layer) -> void
         {
             layers.push_back(layer);
+#ifdef EVT_PROFILE_LAYERS
+            profiles.push_back(LayerProfile{layer});
+#endif
             layer->on_attach();
         }
 
@@ -118,14 +222,19 @@ namespace Event
             if (itr != layers.end())
             {
                 layer->on_detach();
+#ifdef EVT_PROFILE_LAYERS
+                profiles.erase(profiles.begin() + (itr - layers.begin()));
+#endif
                 layers.erase(itr);
             }
         }
 
+#ifndef EVT_PROFILE_LAYERS
         inline auto propegate_event(const AbstractEvent &event) -> bool
         {
             for (auto l : *this)
             {
+                PROFILE_SCOPE(l->debug_name());
                 if (l->on_event(event))
                 {
                     return true;
@@ -134,6 +243,51 @@ namespace Event
 
             return false;
         }
+#else
+        inline auto propegate_event(const AbstractEvent &event) -> bool;
+
+        // One entry per layer, in push order. Can be polled every frame, eg.: by an overlay.
+        inline auto get_profiles() const -> const std::vector<LayerProfile> &
+        {
+            return profiles;
+        }
+
+        inline auto reset_profiles() -> void
+        {
+            for (auto &p : profiles)
+                p.per_type = {};
+
+            since_dump = 0;
+        }
+
+        inline auto dump_profiles(const Log::Logger &logger = Log::debug) const -> void
+        {
+            if (not logger.is_active())
+                return;
+
+            for (const auto &p : profiles)
+            {
+                for (size_t t = 0; t < p.per_type.size(); t++)
+                {
+                    const auto &stats = p.per_type[t];
+                    if (stats.count == 0)
+                        continue;
+
+                    logger(Log::format("%s/%s: count=%zu total=%.3fms mean=%.2fus p99<=%.2fus max=%.2fus",
+                                       p.layer->debug_name(), type_name(static_cast<Type>(t)), stats.count,
+                                       stats.total_ns / 1e6, stats.mean_ns() / 1e3,
+                                       stats.percentile_ns(0.99) / 1e3, stats.max_ns / 1e3));
+                }
+            }
+        }
+
+        // Dump and reset the profiles every time this many seconds of AppTicks went by, zero disables it.
+        inline auto set_profile_dump_interval(double seconds) -> LayerStack &
+        {
+            dump_interval = seconds;
+            return *this;
+        }
+#endif
 
         inline auto begin() -> std::vector<AbstractLayer *>::reverse_iterator { return layers.rbegin(); }
 
@@ -141,6 +295,11 @@ namespace Event
 
     private:
         std::vector<AbstractLayer *> layers;
+
+#ifdef EVT_PROFILE_LAYERS
+        std::vector<LayerProfile> profiles;
+        double dump_interval{0}, since_dump{0};
+#endif
     };
 
     // Implement basic events
@@ -258,13 +417,56 @@ namespace Event
         const double x, y;
     };
 
+#ifdef EVT_PROFILE_LAYERS
+    // Defined here, after AppTick is complete.
+    inline auto LayerStack::propegate_event(const AbstractEvent &event) -> bool
+    {
+        using Clock = std::chrono::steady_clock;
+
+        const auto type = static_cast<size_t>(event.type());
+        bool handled{false};
+
+        for (size_t i = layers.size(); i-- > 0;)
+        {
+            PROFILE_SCOPE(layers[i]->debug_name());
+            const auto start = Clock::now();
+            handled = layers[i]->on_event(event);
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+            profiles[i].per_type[type].record(static_cast<uint64_t>(ns));
+
+            if (handled)
+                break;
+        }
+
+        if (dump_interval > 0 && event.type() == Type::AppTick)
+        {
+            since_dump += event.as<AppTick>().dt;
+            if (since_dump >= dump_interval)
+            {
+                ALLOC_EXEMPT();
+                dump_profiles();
+                reset_profiles();
+            }
+        }
+
+        return handled;
+    }
+#endif
+
     class EventLoggerLayer : public AbstractLayer
     {
     public:
         Log::Logger logger{"EVENT", Log::Color::Cyan, 5};
 
+        virtual inline auto debug_name() const -> const char * override { return "EventLoggerLayer"; }
+
         virtual inline auto on_event(const AbstractEvent &event) -> bool override
         {
+            // Skip the blacklist lookups and debug_string() formatting when nothing would be written.
+            if (not logger.is_active())
+                return false;
+
             auto itr = std::find_if(cat_blacklist.begin(), cat_blacklist.end(), [&event](Category cat)
                                     { return event.in_category(cat); });
 
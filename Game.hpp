@@ -0,0 +1,244 @@
+#ifndef GAME_HPP
+#define GAME_HPP
+
+#include "Collision.hpp"
+#include "ECS.hpp"
+#include "Graphics.hpp"
+#include "Profile.hpp"
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/*
+Components and systems of the asteroids game that do not depend on the application: the demo's GameLayer drives them
+every tick, and the benchmarks drive them directly on generated scenes (see Scenario.hpp).
+*/
+
+namespace Game
+{
+    // World space is 16:9, spanning [-WORLD_HALF_WIDTH, WORLD_HALF_WIDTH] x [-1, 1].
+    constexpr float WORLD_HALF_WIDTH = 16.0f / 9.0f;
+
+    // Number of asteroid outline templates; each one is drawn with a single instanced draw call.
+    constexpr size_t ASTEROID_SHAPES = 8;
+
+    // Template of the bullets, after the ship and the asteroids.
+    constexpr size_t BULLET_SHAPE = ASTEROID_SHAPES + 1;
+
+    // Default side of the collision grid's cells: the largest asteroid plus the ship, so that the 3x3 cells around
+    // anything hold every asteroid it can touch.
+    constexpr float COLLISION_CELL = 0.2f;
+
+    struct Velocity
+    {
+        float x, y, spin;
+    };
+
+    // Index of the polygon template an entity is drawn with.
+    struct Shape
+    {
+        size_t index;
+    };
+
+    struct Ship
+    {
+    };
+
+    struct Asteroid
+    {
+    };
+
+    // Seconds until the bullet disappears.
+    struct Bullet
+    {
+        float life;
+    };
+
+    using AsteroidPrefab = ECS::Prefab<Graphics::Transform2D, Velocity, Shape, Asteroid>;
+    using BulletPrefab = ECS::Prefab<Graphics::Transform2D, Velocity, Shape, Bullet>;
+
+    inline auto make_asteroid_shape(std::mt19937 &rng) -> std::vector<Graphics::Vec2>
+    {
+        // Jittered angles on the unit circle keep the outline convex.
+        constexpr size_t VERTICES = 11;
+        std::uniform_real_distribution<float> jitter(-0.25f, 0.25f);
+
+        std::vector<Graphics::Vec2> points;
+        for (size_t i = 0; i < VERTICES; i++)
+        {
+            const float theta = (i + jitter(rng)) * 6.2831853f / VERTICES;
+            points.push_back({std::cos(theta), std::sin(theta)});
+        }
+        return points;
+    }
+
+    // Outline templates, indexed by Shape::index: the ship, then ASTEROID_SHAPES asteroids and the bullet.
+    inline auto make_shapes(std::mt19937 &rng) -> std::vector<std::vector<Graphics::Vec2>>
+    {
+        std::vector<std::vector<Graphics::Vec2>> shapes;
+        shapes.push_back({{1.0f, 0.0f}, {-0.7f, 0.6f}, {-0.7f, -0.6f}});
+        for (size_t i = 0; i < ASTEROID_SHAPES; i++)
+            shapes.push_back(make_asteroid_shape(rng));
+        shapes.push_back({{1.0f, 0.0f}, {0.0f, 1.0f}, {-1.0f, 0.0f}, {0.0f, -1.0f}});
+        return shapes;
+    }
+
+    // Moves and spins everything with a velocity, wrapping around the edges of the world.
+    inline auto move(ECS::Scene &scene, float dt) -> void
+    {
+        PROFILE_SCOPE("Game::move");
+
+        for (auto [id, transform, velocity] : scene.view<Graphics::Transform2D, Velocity>())
+        {
+            transform.x += dt * velocity.x;
+            transform.y += dt * velocity.y;
+            transform.rotation += dt * velocity.spin;
+
+            if (transform.x > WORLD_HALF_WIDTH)
+                transform.x -= 2 * WORLD_HALF_WIDTH;
+            else if (transform.x < -WORLD_HALF_WIDTH)
+                transform.x += 2 * WORLD_HALF_WIDTH;
+            if (transform.y > 1.0f)
+                transform.y -= 2.0f;
+            else if (transform.y < -1.0f)
+                transform.y += 2.0f;
+        }
+    }
+
+    /*
+    Finds the asteroids that bullets and ships touch: asteroids go into a UniformGrid, bullets and ships are tested
+    against the asteroids around them. Contacts name the asteroid as body a; entity_of maps bodies back to entities.
+    */
+    class Collisions
+    {
+    public:
+        // Registers the outline templates, indexed like Shape::index. Bullets collide as points.
+        inline auto set_shapes(const std::vector<std::vector<Graphics::Vec2>> &shapes) -> Collisions &
+        {
+            for (size_t i = 0; i < shapes.size(); i++)
+            {
+                if (i == BULLET_SHAPE)
+                {
+                    const Graphics::Vec2 origin{0.0f, 0.0f};
+                    collision_shapes.push_back(narrow_phase.add_shape(&origin, 1));
+                }
+                else
+                    collision_shapes.push_back(narrow_phase.add_shape(shapes[i].data(), shapes[i].size()));
+            }
+            return *this;
+        }
+
+        // Must be at least the largest asteroid's radius plus the largest bullet's or ship's.
+        inline auto set_cell_size(float value) -> Collisions &
+        {
+            cell_size = value;
+            return *this;
+        }
+
+        // Sizes the per-frame buffers, so that frames up to these counts do not allocate.
+        inline auto reserve(size_t bodies, size_t pairs) -> void
+        {
+            narrow_phase.reserve(bodies, pairs);
+            grid.reserve(bodies);
+            body_entity.reserve(bodies);
+            handled.reserve(bodies);
+        }
+
+        inline auto detect(ECS::Scene &scene) -> const std::vector<Collision::Contact> &
+        {
+            PROFILE_SCOPE("Game::Collisions::detect");
+
+            narrow_phase.begin();
+            grid.reset(-WORLD_HALF_WIDTH, -1.0f, WORLD_HALF_WIDTH, 1.0f, cell_size);
+            body_entity.clear();
+
+            for (auto [id, transform, shape, asteroid] : scene.view<Graphics::Transform2D, Shape, Asteroid>())
+            {
+                grid.insert(add_body(id, shape, transform), transform.x, transform.y);
+            }
+            grid.build();
+
+            for (auto [id, transform, shape, bullet] : scene.view<Graphics::Transform2D, Shape, Bullet>())
+                probe(id, shape, transform);
+            for (auto [id, transform, shape, ship] : scene.view<Graphics::Transform2D, Shape, Ship>())
+                probe(id, shape, transform);
+
+            handled.assign(body_entity.size(), 0);
+            return narrow_phase.run();
+        }
+
+        // Lets each body take part in at most one contact per frame: false if either body of the contact was already
+        // claimed since the last detect, otherwise marks both. Bodies of entities released or recycled while resolving
+        // contacts stay marked, so later contacts never reach them.
+        inline auto claim(const Collision::Contact &contact) -> bool
+        {
+            if (handled[contact.a] || handled[contact.b])
+                return false;
+
+            handled[contact.a] = handled[contact.b] = 1;
+            return true;
+        }
+
+        inline auto entity_of(Collision::BodyID body) const -> ECS::EntityID
+        {
+            return body_entity[body];
+        }
+
+        inline auto get_stats() const -> const Collision::NarrowPhase::Stats &
+        {
+            return narrow_phase.get_stats();
+        }
+
+    private:
+        inline auto add_body(ECS::EntityID id, const Shape &shape, const Graphics::Transform2D &transform) -> Collision::BodyID
+        {
+            body_entity.push_back(id);
+            return narrow_phase.add_body(collision_shapes[shape.index], transform);
+        }
+
+        inline auto probe(ECS::EntityID id, const Shape &shape, const Graphics::Transform2D &transform) -> void
+        {
+            const auto body = add_body(id, shape, transform);
+            grid.query(transform.x, transform.y, [&](Collision::BodyID asteroid)
+                       { narrow_phase.add_pair(asteroid, body); });
+        }
+
+        float cell_size{COLLISION_CELL};
+        Collision::UniformGrid grid;
+        Collision::NarrowPhase narrow_phase;
+        std::vector<Collision::ShapeID> collision_shapes; // Indexed by Shape::index
+        std::vector<ECS::EntityID> body_entity;           // Indexed by Collision::BodyID
+        std::vector<uint8_t> handled;                     // Indexed by Collision::BodyID, cleared by detect
+    };
+
+    // Records one DrawInstances per outline template in use and writes every transform straight into its command.
+    // `counts` and `instances` are scratch space with one entry per template.
+    inline auto record_meshes(ECS::Scene &scene, Graphics::Render::CommandBuffer &commands, std::vector<uint32_t> &counts,
+                              std::vector<Graphics::Transform2D *> &instances) -> void
+    {
+        PROFILE_SCOPE("Game::record_meshes");
+        using namespace Graphics::Render;
+
+        // Count first, so every template's transforms can be written straight into its command.
+        std::fill(instances.begin(), instances.end(), nullptr);
+        std::fill(counts.begin(), counts.end(), 0);
+        for (auto [id, transform, shape] : scene.view<Graphics::Transform2D, Shape>())
+            counts[shape.index]++;
+
+        for (size_t i = 0; i < counts.size(); i++)
+        {
+            if (counts[i])
+                instances[i] = commands.record<DrawInstances, Graphics::Transform2D>({static_cast<uint32_t>(i), counts[i]}, counts[i]);
+        }
+
+        for (auto [id, transform, shape] : scene.view<Graphics::Transform2D, Shape>())
+            *instances[shape.index]++ = transform;
+    }
+}
+
+#endif
@@ -3,16 +3,28 @@
 
 #include "Error.hpp"
 #include "Event.hpp"
+#include "Font.hpp"
+#include "Memory.hpp"
+#include "Profile.hpp"
+#include "GraphicsBackend.hpp"
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 #include <GL/glew.h>
 
+#include <algorithm>
 #include <functional>
 #include <unordered_map>
 #include <fstream>
 #include <initializer_list>
 #include <memory>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <string_view>
+#include <iterator>
+#include <cmath>
+#include <vector>
 
 #define WIN_EVT_CALLBACK(winptr) *static_cast<EventCallbackFn *>(glfwGetWindowUserPointer(winptr))
 
@@ -20,6 +32,323 @@
 
 namespace Graphics
 {
+    // Headless windows have no native window or GL context: they emit synthetic AppTicks and never swap buffers.
+    enum class Platform
+    {
+        GLFW,
+        Headless
+    };
+
+#ifdef GRAPHICS_HEADLESS
+    constexpr Platform DEFAULT_PLATFORM = Platform::Headless;
+#else
+    constexpr Platform DEFAULT_PLATFORM = Platform::GLFW;
+#endif
+
+    /*
+    Mirrors the GL binding state of the current context, so binds of objects that are already bound are skipped.
+    Every bind, unbind and delete in this file goes through it; GL code elsewhere that changes bindings must call
+    invalidate() afterwards.
+    */
+    class StateCache
+    {
+    public:
+        struct Counters
+        {
+            size_t issued{0}, elided{0};
+        };
+
+        inline auto bind_buffer(unsigned int target, unsigned int id) -> void
+        {
+            const size_t slot = buffer_slot(target);
+            if (slot < buffers.size() && buffers[slot] == id)
+                return elide();
+
+            backend().bind_buffer(target, id);
+            if (slot < buffers.size())
+                buffers[slot] = id;
+            issue();
+        }
+
+        inline auto bind_vertex_array(unsigned int id) -> void
+        {
+            if (vertex_array == id)
+                return elide();
+
+            backend().bind_vertex_array(id);
+            vertex_array = id;
+            issue();
+
+            // The element array binding is part of the vertex array's state.
+            buffers[buffer_slot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+        }
+
+        inline auto bind_texture(unsigned int unit, unsigned int id) -> void
+        {
+            if (unit < textures.size() && textures[unit] == id)
+                return elide();
+
+            backend().bind_texture(unit, id);
+            if (unit < textures.size())
+                textures[unit] = id;
+            issue();
+        }
+
+        inline auto use_program(unsigned int id) -> void
+        {
+            if (program == id)
+                return elide();
+
+            backend().use_program(id);
+            program = id;
+            issue();
+        }
+
+        // Deleting a bound object reverts its binding points to 0.
+        inline auto delete_buffer(unsigned int id) -> void
+        {
+            backend().delete_buffer(id);
+            for (auto &buffer : buffers)
+            {
+                if (buffer == id)
+                    buffer = 0;
+            }
+        }
+
+        inline auto delete_vertex_array(unsigned int id) -> void
+        {
+            backend().delete_vertex_array(id);
+            if (vertex_array == id)
+            {
+                vertex_array = 0;
+                buffers[buffer_slot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+            }
+        }
+
+        inline auto delete_texture(unsigned int id) -> void
+        {
+            backend().delete_texture(id);
+            for (auto &texture : textures)
+            {
+                if (texture == id)
+                    texture = 0;
+            }
+        }
+
+        inline auto delete_program(unsigned int id) -> void
+        {
+            backend().delete_program(id);
+            if (program == id)
+                program = 0;
+        }
+
+        // Forget everything, e.g. after switching contexts. The next bind of every kind is issued.
+        inline auto invalidate() -> void
+        {
+            buffers.fill(UNKNOWN);
+            textures.fill(UNKNOWN);
+            vertex_array = program = UNKNOWN;
+        }
+
+        // Closes the counters of the current frame.
+        inline auto end_frame() -> void
+        {
+            last_frame = frame;
+            frame = Counters{};
+        }
+
+        inline auto get_frame_counters() const -> const Counters &
+        {
+            return last_frame;
+        }
+
+    private:
+        static constexpr unsigned int UNKNOWN = static_cast<unsigned int>(-1);
+
+        // Targets without a slot are never cached.
+        static constexpr inline auto buffer_slot(unsigned int target) -> size_t
+        {
+            switch (target)
+            {
+            case GL_ARRAY_BUFFER:
+                return 0;
+            case GL_ELEMENT_ARRAY_BUFFER:
+                return 1;
+            case GL_UNIFORM_BUFFER:
+                return 2;
+            default:
+                return static_cast<size_t>(-1);
+            }
+        }
+
+        inline auto issue() -> void
+        {
+            frame.issued++;
+        }
+
+        inline auto elide() -> void
+        {
+            frame.elided++;
+        }
+
+        std::array<unsigned int, 3> buffers{UNKNOWN, UNKNOWN, UNKNOWN};
+        // Units beyond these are not cached
+        std::array<unsigned int, 8> textures{UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN};
+        unsigned int vertex_array{UNKNOWN}, program{UNKNOWN};
+        Counters frame, last_frame;
+    };
+
+    inline auto state() -> StateCache &
+    {
+        static StateCache cache;
+        return cache;
+    }
+
+    enum class FramePhase
+    {
+        Poll,
+        Tick,
+        Swap,
+        // The whole frame: time since the previous frame started, the dt of its AppTick.
+        Frame,
+        // Not a phase, keep it last.
+        Count
+    };
+
+    inline auto frame_phase_name(FramePhase phase) -> const char *
+    {
+        switch (phase)
+        {
+        case FramePhase::Poll:
+            return "Poll";
+        case FramePhase::Tick:
+            return "Tick";
+        case FramePhase::Swap:
+            return "Swap";
+        case FramePhase::Frame:
+            return "Frame";
+        default:
+            return "None";
+        }
+    }
+
+    // CPU time spent in each phase of Window::on_update, over a sliding window of the most recent frames.
+    class FrameTimings
+    {
+    public:
+        struct Sample
+        {
+            std::array<double, static_cast<size_t>(FramePhase::Count)> ms{};
+
+            inline auto operator[](FramePhase phase) -> double &
+            {
+                return ms[static_cast<size_t>(phase)];
+            }
+
+            inline auto operator[](FramePhase phase) const -> double
+            {
+                return ms[static_cast<size_t>(phase)];
+            }
+        };
+
+        FrameTimings(size_t capacity = 300) : samples(capacity)
+        {
+            ASSERT(capacity, "FrameTimings needs room for at least one frame");
+            scratch.reserve(capacity);
+        }
+
+        inline auto record(const Sample &sample) -> void
+        {
+            samples[next] = sample;
+            next = (next + 1) % samples.size();
+            count = std::min(count + 1, samples.size());
+
+            frames++;
+            if (sample[FramePhase::Frame] > budget_ms)
+                over_budget++;
+        }
+
+        // Exact percentile (0..1) of a phase over the frames in the window.
+        inline auto percentile(FramePhase phase, double p) const -> double
+        {
+            if (not count)
+                return 0.0;
+
+            scratch.clear();
+            for (size_t i = 0; i < count; i++)
+                scratch.push_back(samples[i][phase]);
+
+            const size_t k = std::min(count - 1, static_cast<size_t>(p * count));
+            std::nth_element(scratch.begin(), scratch.begin() + k, scratch.end());
+            return scratch[k];
+        }
+
+        inline auto max(FramePhase phase) const -> double
+        {
+            double result{0.0};
+            for (size_t i = 0; i < count; i++)
+                result = std::max(result, samples[i][phase]);
+            return result;
+        }
+
+        inline auto get_last() const -> const Sample &
+        {
+            return samples[(next + samples.size() - 1) % samples.size()];
+        }
+
+        // Frames longer than this count as over budget.
+        inline auto set_budget_ms(double ms) -> FrameTimings &
+        {
+            budget_ms = ms;
+            return *this;
+        }
+
+        inline auto get_budget_ms() const -> double
+        {
+            return budget_ms;
+        }
+
+        // Frames recorded since the last reset, not just the ones in the window.
+        inline auto get_frame_count() const -> size_t
+        {
+            return frames;
+        }
+
+        inline auto get_over_budget_count() const -> size_t
+        {
+            return over_budget;
+        }
+
+        inline auto reset() -> void
+        {
+            next = count = frames = over_budget = 0;
+        }
+
+        inline auto dump(const Log::Logger &logger = Log::debug) const -> void
+        {
+            if (not logger.is_active())
+                return;
+
+            for (size_t i = 0; i < static_cast<size_t>(FramePhase::Count); i++)
+            {
+                const auto phase = static_cast<FramePhase>(i);
+                logger(Log::format("%s: p50=%.2fms p95=%.2fms p99=%.2fms max=%.2fms", frame_phase_name(phase),
+                                   percentile(phase, 0.5), percentile(phase, 0.95), percentile(phase, 0.99), max(phase)));
+            }
+
+            logger(Log::format("%zu of %zu frame(s) over the %.2fms budget", over_budget, frames, budget_ms));
+        }
+
+    private:
+        std::vector<Sample> samples;
+        mutable std::vector<double> scratch;
+        size_t next{0}, count{0};
+
+        // A missed vblank at 60 Hz shows up as a ~33 ms frame.
+        double budget_ms{20.0};
+        size_t frames{0}, over_budget{0};
+    };
+
     class Window
     {
     public:
@@ -29,8 +358,14 @@ namespace Graphics
         {
         }
 
-        Window(const char *title, size_t width, size_t height)
+        Window(const char *title, size_t width, size_t height, Platform platform = DEFAULT_PLATFORM)
+            : platform(platform), headless_width(width), headless_height(height)
         {
+            if (is_headless())
+            {
+                LOG_INFO("Created headless window \"%s\" (%zux%zu)", title, width, height);
+                return;
+            }
 
             if (not Window::INITIALIZED_DEPS)
             {
@@ -38,10 +373,10 @@ namespace Graphics
                 ASSERT(glfw_success, "Could not initialize GLFW");
 
                 glfwSetErrorCallback([](int code, const char *desc)
-                                     { Log::error(Log::format("GLFW error(%u): %s", code, desc)); });
+                                     { LOG_ERROR("GLFW error(%u): %s", code, desc); });
 
-                Log::info(Log::format("Compiled against GLFW %i.%i.%i", GLFW_VERSION_MAJOR, GLFW_VERSION_MINOR, GLFW_VERSION_REVISION));
-                Log::info(Log::format("Running against GLFW %s", glfwGetVersionString()));
+                LOG_INFO("Compiled against GLFW %i.%i.%i", GLFW_VERSION_MAJOR, GLFW_VERSION_MINOR, GLFW_VERSION_REVISION);
+                LOG_INFO("Running against GLFW %s", glfwGetVersionString());
 
                 Window::INITIALIZED_DEPS = true;
             }
@@ -58,40 +393,129 @@ namespace Graphics
 
         inline auto on_update() -> void
         {
-            static double prev_time{0}, curr_time{0};
+            using Clock = std::chrono::steady_clock;
+            const auto ms = [](Clock::time_point from, Clock::time_point to) -> double
+            {
+                return std::chrono::duration<double, std::milli>(to - from).count();
+            };
+
+            PROFILE_NEXT_FRAME();
+            PROFILE_SCOPE("Window::on_update");
+
+            FrameTimings::Sample sample;
+            const auto start = Clock::now();
+            sample[FramePhase::Frame] = ms(frame_start, start);
+            frame_start = start;
+
+            if (is_headless())
+            {
+                if (ticks == 0)
+                    first_tick = start;
+
+                event_callback(Event::AppTick(synthetic_dt));
+                const auto ticked = Clock::now();
+                sample[FramePhase::Tick] = ms(start, ticked);
+                record_frame(sample);
+
+                if (++ticks == tick_limit || (time_limit > 0.0 && ms(first_tick, ticked) >= time_limit * 1000.0))
+                    event_callback(Event::WindowClose());
+
+                return;
+            }
 
-            curr_time = glfwGetTime();
-            const double dt = curr_time - prev_time;
-            prev_time = curr_time;
+            {
+                PROFILE_SCOPE("Window::poll");
+                glfwPollEvents();
+            }
+            const auto polled = Clock::now();
+
+            event_callback(Event::AppTick(sample[FramePhase::Frame] / 1000.0));
+            const auto ticked = Clock::now();
+
+            // Otherwise whoever holds the context presents
+            if (not context_released)
+            {
+                PROFILE_SCOPE("Window::swap");
+                glfwSwapBuffers(window_handle);
+                state().end_frame();
+                backend().end_frame();
+            }
 
-            glfwPollEvents();
-            event_callback(Event::AppTick(dt));
-            glfwSwapBuffers(window_handle);
+            sample[FramePhase::Poll] = ms(start, polled);
+            sample[FramePhase::Tick] = ms(polled, ticked);
+            sample[FramePhase::Swap] = ms(ticked, Clock::now());
+            record_frame(sample);
+            ticks++;
         }
 
         inline auto make_current() -> Window &
         {
+            if (is_headless())
+                return *this;
+
             glfwMakeContextCurrent(window_handle);
             [[maybe_unused]] const GLenum glew_success = glewInit();
             ASSERT(glew_success == GLEW_OK, "Could not (re)initialize GLEW on active context");
+            // Instanced draws read from an offset into a shared stream buffer (see VertexArray::draw_instanced).
+            ASSERT(GLEW_VERSION_4_2 || GLEW_ARB_base_instance, "Instanced drawing needs OpenGL 4.2 or ARB_base_instance, which this context lacks");
+
+            state().invalidate();
 
             return *this;
         }
 
+        // Detaches the GL context from the calling thread, so another thread can make it current and present frames.
+        // on_update stops swapping buffers until the context is reclaimed.
+        inline auto release_context() -> Window &
+        {
+            if (is_headless())
+                return *this;
+
+            glfwMakeContextCurrent(nullptr);
+            context_released = true;
+            return *this;
+        }
+
+        inline auto reclaim_context() -> Window &
+        {
+            context_released = false;
+            return make_current();
+        }
+
+        // Must be called on the thread the context is current on.
+        inline auto swap_buffers() -> void
+        {
+            if (not is_headless())
+                glfwSwapBuffers(window_handle);
+        }
+
         inline auto set_size(size_t width, size_t height) -> Window &
         {
+            if (is_headless())
+            {
+                headless_width = width;
+                headless_height = height;
+                return *this;
+            }
+
             glfwSetWindowSize(window_handle, (int)width, (int)height);
             return *this;
         }
 
         inline auto set_title(const char *title) -> Window &
         {
+            if (is_headless())
+                return *this;
+
             glfwSetWindowTitle(window_handle, title);
             return *this;
         }
 
         inline auto set_vsync(bool value) -> Window &
         {
+            if (is_headless())
+                return *this;
+
             glfwSwapInterval(static_cast<int>(value));
             return *this;
         }
@@ -104,32 +528,59 @@ namespace Graphics
 
         inline auto set_size_constraints(size_t min_width, size_t min_height, size_t max_width, size_t max_height) -> Window &
         {
+            if (is_headless())
+                return *this;
+
             glfwSetWindowSizeLimits(window_handle, min_width, min_height, max_width, max_height);
             return *this;
         }
 
         inline auto set_aspect_constraints(size_t width, size_t height) -> Window &
         {
+            if (is_headless())
+                return *this;
+
             glfwSetWindowAspectRatio(window_handle, width, height);
             return *this;
         }
 
         inline auto set_icon(const std::vector<GLFWimage> &icons) -> Window &
         {
+            if (is_headless())
+                return *this;
+
             glfwSetWindowIcon(window_handle, icons.size(), icons.data());
             return *this;
         }
 
         inline auto get_size() const -> std::pair<int, int>
         {
+            if (is_headless())
+                return std::make_pair((int)headless_width, (int)headless_height);
+
             int width, height;
             glfwGetWindowSize(window_handle, &width, &height);
 
             return std::make_pair(width, height);
         }
 
+        // Size in pixels, which differs from get_size on high-DPI displays.
+        inline auto get_framebuffer_size() const -> std::pair<int, int>
+        {
+            if (is_headless())
+                return std::make_pair((int)headless_width, (int)headless_height);
+
+            int width, height;
+            glfwGetFramebufferSize(window_handle, &width, &height);
+
+            return std::make_pair(width, height);
+        }
+
         inline auto set_fullscreen(bool val) -> Window &
         {
+            if (is_headless())
+                return *this;
+
             // In case one would call set_fullscreen(false) before set_fullscreen(true) first
             static int x{100}, y{100}, width{640}, height(480);
 
@@ -155,8 +606,65 @@ namespace Graphics
             return window_handle;
         }
 
+        inline auto is_headless() const -> bool
+        {
+            return platform == Platform::Headless;
+        }
+
+        // Fixed dt reported by the AppTicks of a headless window.
+        inline auto set_synthetic_dt(double dt) -> Window &
+        {
+            synthetic_dt = dt;
+            return *this;
+        }
+
+        inline auto get_synthetic_dt() const -> double
+        {
+            return synthetic_dt;
+        }
+
+        inline auto get_frame_timings() -> FrameTimings &
+        {
+            return frame_timings;
+        }
+
+        inline auto get_frame_timings() const -> const FrameTimings &
+        {
+            return frame_timings;
+        }
+
+        // Dump the frame timings every time this many seconds of frames went by, zero disables it.
+        inline auto set_frame_dump_interval(double seconds) -> Window &
+        {
+            frame_dump_interval = seconds;
+            return *this;
+        }
+
+        // A headless window emits WindowClose after this many ticks, zero means run until closed.
+        inline auto set_tick_limit(size_t limit) -> Window &
+        {
+            tick_limit = limit;
+            return *this;
+        }
+
+        // A headless window emits WindowClose once this many seconds went by since its first tick, zero means no limit.
+        // Whichever of the tick and the time limit is reached first ends the run.
+        inline auto set_time_limit(double seconds) -> Window &
+        {
+            time_limit = seconds;
+            return *this;
+        }
+
+        inline auto get_tick_count() const -> size_t
+        {
+            return ticks;
+        }
+
         ~Window()
         {
+            if (is_headless())
+                return;
+
             glfwDestroyWindow(window_handle);
             if (--Window::WINDOWS_ALIVE == 0)
             {
@@ -166,6 +674,22 @@ namespace Graphics
         }
 
     private:
+        inline auto record_frame(const FrameTimings::Sample &sample) -> void
+        {
+            frame_timings.record(sample);
+
+            if (frame_dump_interval <= 0)
+                return;
+
+            since_frame_dump += sample[FramePhase::Frame] / 1000.0;
+            if (since_frame_dump >= frame_dump_interval)
+            {
+                ALLOC_EXEMPT();
+                frame_timings.dump();
+                since_frame_dump = 0;
+            }
+        }
+
         inline auto init_glfw_event_callbacks() -> void
         {
             // Set WindowUserPointer to our event callback function, to be able to access it elsewhere.
@@ -243,16 +767,31 @@ namespace Graphics
                 auto &callback = WIN_EVT_CALLBACK(window);
                 callback(Event::WindowRedraw()); });
 
-            glfwSetFramebufferSizeCallback(window_handle, [](GLFWwindow *, int width, int height) -> void
-                                           { glViewport(0, 0, width, height); });
+            // Only if the context is current here; a render thread sets its own viewport.
+            glfwSetFramebufferSizeCallback(window_handle, [](GLFWwindow *window, int width, int height) -> void
+                                           {
+                if (glfwGetCurrentContext() == window)
+                    backend().viewport(0, 0, width, height); });
         }
 
     private:
         static bool INITIALIZED_DEPS;
         static size_t WINDOWS_ALIVE;
 
-        GLFWwindow *window_handle;
+        Platform platform;
+        GLFWwindow *window_handle{nullptr};
         EventCallbackFn event_callback;
+
+        size_t headless_width, headless_height;
+        double synthetic_dt{1.0 / 60.0};
+        size_t ticks{0}, tick_limit{0};
+        double time_limit{0.0};
+        std::chrono::steady_clock::time_point first_tick;
+        bool context_released{false};
+
+        FrameTimings frame_timings;
+        std::chrono::steady_clock::time_point frame_start{std::chrono::steady_clock::now()};
+        double frame_dump_interval{0}, since_frame_dump{0};
     };
     // Define Window's static members
     bool Window::INITIALIZED_DEPS = false;
@@ -266,33 +805,63 @@ namespace Graphics
         Byte = GL_UNSIGNED_BYTE,
     };
 
+    enum class Primitive
+    {
+        Triangles = GL_TRIANGLES,
+        Lines = GL_LINES,
+        LineLoop = GL_LINE_LOOP,
+    };
+
     class IndexBuffer
     {
     public:
-        IndexBuffer(const unsigned int *data, size_t count)
+        IndexBuffer(const unsigned int *data, size_t count) : count(count)
+        {
+            id = backend().create_buffer();
+            state().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, id);
+            backend().buffer_data(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * count, data, GL_STATIC_DRAW);
+        }
+
+        // Creates an uninitialized buffer of `count` indices meant to be updated with set_data.
+        IndexBuffer(size_t count) : count(count)
         {
-            glGenBuffers(1, &id);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * count, data, GL_STATIC_DRAW);
+            id = backend().create_buffer();
+            state().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, id);
+            backend().buffer_data(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * count, nullptr, GL_DYNAMIC_DRAW);
         }
 
         ~IndexBuffer()
         {
-            glDeleteBuffers(1, &id);
+            state().delete_buffer(id);
         }
 
         inline auto bind() const -> void
         {
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id);
+            state().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, id);
         }
 
         inline auto unbind() const -> void
         {
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+            state().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        }
+
+        // Overwrites `data_count` indices starting at index `first`.
+        inline auto set_data(const unsigned int *data, size_t data_count, size_t first = 0) -> void
+        {
+            ASSERT(first + data_count <= count, "Write past the end of the IndexBuffer");
+
+            bind();
+            backend().buffer_sub_data(GL_ELEMENT_ARRAY_BUFFER, first * sizeof(unsigned int), data_count * sizeof(unsigned int), data);
+        }
+
+        inline auto get_count() const -> size_t
+        {
+            return count;
         }
 
     private:
         unsigned int id;
+        size_t count;
     };
 
     class VertexBuffer
@@ -324,70 +893,363 @@ namespace Graphics
         {
             size_t stride;
             std::vector<LayoutElement> elements;
+            // 0 advances the attributes per vertex, n > 0 advances them once every n instances.
+            unsigned int divisor{0};
         };
 
     public:
-        VertexBuffer(const void *data, size_t size)
+        VertexBuffer(const void *data, size_t size) : size(size)
         {
-            glGenBuffers(1, &id);
-            glBindBuffer(GL_ARRAY_BUFFER, id);
-            glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+            id = backend().create_buffer();
+            state().bind_buffer(GL_ARRAY_BUFFER, id);
+            backend().buffer_data(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+        }
+
+        // Creates an uninitialized buffer meant to be refilled every frame with allocate and set_data.
+        VertexBuffer(size_t size) : size(size)
+        {
+            id = backend().create_buffer();
+            state().bind_buffer(GL_ARRAY_BUFFER, id);
+            backend().buffer_data(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
         }
 
         ~VertexBuffer()
         {
-            glDeleteBuffers(1, &id);
+            state().delete_buffer(id);
         }
 
         inline auto bind() const -> void
         {
-            glBindBuffer(GL_ARRAY_BUFFER, id);
+            state().bind_buffer(GL_ARRAY_BUFFER, id);
         }
 
         inline auto unbind() const -> void
         {
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            state().bind_buffer(GL_ARRAY_BUFFER, 0);
+        }
+
+        inline auto set_layout(std::initializer_list<LayoutElement> elements, unsigned int divisor = 0) -> void
+        {
+            layout = make_layout(elements, divisor);
         }
 
-        inline auto set_layout(std::initializer_list<LayoutElement> elements) -> void
+        static inline auto make_layout(std::initializer_list<LayoutElement> elements, unsigned int divisor = 0) -> Layout
         {
-            layout.elements.clear();
-            layout.stride = 0;
+            Layout layout{0, {}, divisor};
             for (const auto &e : elements)
             {
                 layout.elements.push_back(e);
                 layout.stride += e.size_of_type() * e.count;
             }
+            return layout;
+        }
+
+        // Replaces the data store with a fresh one of (at least) the given size. The old store is orphaned,
+        // so the driver does not have to wait for draws that still read from it.
+        inline auto allocate(size_t new_size) -> void
+        {
+            size = std::max(size, new_size);
+            bind();
+            backend().buffer_data(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        }
+
+        inline auto set_data(const void *data, size_t data_size, size_t offset = 0) -> void
+        {
+            ASSERT(offset + data_size <= size, "Write past the end of the VertexBuffer");
+
+            bind();
+            backend().buffer_sub_data(GL_ARRAY_BUFFER, offset, data_size, data);
+        }
+
+        inline auto get_size() const -> size_t
+        {
+            return size;
         }
 
     private:
         unsigned int id;
+        size_t size;
         Layout layout;
 
         friend class VertexArray;
     };
 
-    class VertexArray
+    enum class BufferTarget
     {
-    public:
+        Vertex = GL_ARRAY_BUFFER,
+        Index = GL_ELEMENT_ARRAY_BUFFER,
+    };
+
+    /*
+    Buffer for data that is rewritten every frame. It is split into `regions` equally sized regions used round-robin,
+    one per frame, so the CPU writes one region while the GPU may still read the previous ones.
+
+    With ARB_buffer_storage the whole buffer is persistently mapped and every region is guarded by a fence, which has
+    normally long signalled by the time the ring comes back around. Without it each write maps its range unsynchronized,
+    and the buffer is orphaned whenever the ring wraps, so the driver never has to wait for pending draws either way.
+
+    Allocations return byte offsets: draw from them with `first`/`base_instance` = offset / stride.
+    */
+    class StreamBuffer
+    {
+    public:
+        struct Allocation
+        {
+            void *data;
+            size_t offset;
+        };
+
+        StreamBuffer(BufferTarget target, size_t region_size, size_t regions = 3)
+            : target(static_cast<unsigned int>(target)), region_size(region_size), regions(regions),
+              persistent(backend().supports(Extension::BufferStorage)), fences(regions, nullptr)
+        {
+            create();
+        }
+
+        StreamBuffer(const StreamBuffer &) = delete;
+        StreamBuffer(StreamBuffer &&) = delete;
+        inline auto operator=(const StreamBuffer &) = delete;
+        inline auto operator=(StreamBuffer &&) = delete;
+
+        ~StreamBuffer()
+        {
+            destroy();
+        }
+
+        inline auto bind() const -> void
+        {
+            state().bind_buffer(target, id);
+        }
+
+        inline auto unbind() const -> void
+        {
+            state().bind_buffer(target, 0);
+        }
+
+        inline auto set_layout(std::initializer_list<VertexBuffer::LayoutElement> elements, unsigned int divisor = 0) -> void
+        {
+            layout = VertexBuffer::make_layout(elements, divisor);
+        }
+
+        inline auto get_layout() const -> const VertexBuffer::Layout &
+        {
+            return layout;
+        }
+
+        // Bytes available per frame.
+        inline auto get_region_size() const -> size_t
+        {
+            return region_size;
+        }
+
+        // Recreates the buffer with larger regions. This replaces the GL buffer, so vertex arrays using it must be rebuilt.
+        inline auto reserve(size_t new_region_size) -> void
+        {
+            if (new_region_size <= region_size)
+                return;
+
+            destroy();
+            region_size = new_region_size;
+            create();
+        }
+
+        // Space for `size` bytes in the current frame's region, with an offset that is a multiple of `alignment`.
+        // `data` is nullptr when the region cannot fit the allocation. Call commit once the data is written.
+        inline auto allocate(size_t size, size_t alignment = 1) -> Allocation
+        {
+            const size_t region_begin = region * region_size;
+            const size_t aligned = (region_begin + used + alignment - 1) / alignment * alignment;
+
+            if (aligned + size > region_begin + region_size)
+                return {nullptr, 0};
+
+            used = aligned + size - region_begin;
+
+            if (persistent)
+                return {mapped + aligned, aligned};
+
+            bind();
+            void *data = backend().map_buffer_range(target, aligned, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+            ASSERT(data, "Could not map StreamBuffer range");
+            return {data, aligned};
+        }
+
+        template <typename T>
+        struct InstanceAllocation
+        {
+            T *data;
+            size_t base_instance;
+            bool recreated; // The buffer grew, so vertex arrays using it must be rebuilt before drawing
+        };
+
+        // Space for `count` consecutive instances of T in the current frame's region, growing the buffer when they
+        // do not fit. Call commit once they are written.
+        template <typename T>
+        inline auto allocate_instances(size_t count) -> InstanceAllocation<T>
+        {
+            // One instance of slack for alignment
+            const size_t needed = (count + 1) * sizeof(T);
+            const bool recreated = needed > region_size;
+            if (recreated)
+                reserve(2 * needed);
+
+            const auto allocation = allocate(count * sizeof(T), sizeof(T));
+            return {static_cast<T *>(allocation.data), allocation.offset / sizeof(T), recreated};
+        }
+
+        // Makes the data written into the last allocation visible to the GL.
+        inline auto commit() -> void
+        {
+            // Persistent mappings are coherent
+            if (persistent)
+                return;
+
+            bind();
+            backend().unmap_buffer(target);
+        }
+
+        // Copies `size` bytes into a fresh allocation. Returns false if the region cannot fit them.
+        inline auto write(const void *data, size_t size, size_t alignment, size_t &offset) -> bool
+        {
+            const auto allocation = allocate(size, alignment);
+            if (not allocation.data)
+                return false;
+
+            std::memcpy(allocation.data, data, size);
+            commit();
+
+            offset = allocation.offset;
+            return true;
+        }
+
+        // Call once all draws reading this frame's region have been issued.
+        inline auto next_frame() -> void
+        {
+            if (persistent)
+            {
+                fences[region] = backend().fence();
+                region = (region + 1) % regions;
+                wait(region);
+            }
+            else
+            {
+                region = (region + 1) % regions;
+                if (region == 0)
+                {
+                    // Orphan: draws still reading the old storage keep it alive, new writes get fresh memory.
+                    bind();
+                    backend().buffer_data(target, region_size * regions, nullptr, GL_STREAM_DRAW);
+                }
+            }
+
+            used = 0;
+        }
+
+        // Number of times the CPU had to wait for the GPU to release a region; should stay 0.
+        inline auto get_stall_count() const -> size_t
+        {
+            return stalls;
+        }
+
+        inline auto is_persistent() const -> bool
+        {
+            return persistent;
+        }
+
+    private:
+        inline auto create() -> void
+        {
+            const size_t size = region_size * regions;
+
+            id = backend().create_buffer();
+            bind();
+
+            if (persistent)
+            {
+                constexpr unsigned int flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                backend().buffer_storage(target, size, flags);
+                mapped = static_cast<char *>(backend().map_buffer_range(target, 0, size, flags));
+                ASSERT(mapped, "Could not map StreamBuffer");
+            }
+            else
+            {
+                backend().buffer_data(target, size, nullptr, GL_STREAM_DRAW);
+            }
+
+            region = 0;
+            used = 0;
+        }
+
+        inline auto destroy() -> void
+        {
+            for (auto &fence : fences)
+            {
+                if (fence)
+                    backend().delete_fence(fence);
+                fence = nullptr;
+            }
+
+            if (persistent && mapped)
+            {
+                bind();
+                backend().unmap_buffer(target);
+                mapped = nullptr;
+            }
+
+            state().delete_buffer(id);
+        }
+
+        inline auto wait(size_t index) -> void
+        {
+            auto &fence = fences[index];
+            if (not fence)
+                return;
+
+            if (not backend().wait_fence(fence, false, 0))
+            {
+                stalls++;
+                while (not backend().wait_fence(fence, true, 1'000'000))
+                    ;
+            }
+
+            backend().delete_fence(fence);
+            fence = nullptr;
+        }
+
+        unsigned int id;
+        unsigned int target;
+        size_t region_size, regions;
+        bool persistent;
+
+        char *mapped{nullptr};
+        std::vector<GLsync> fences;
+        size_t region{0}, used{0};
+        size_t stalls{0};
+
+        VertexBuffer::Layout layout{0, {}, 0};
+    };
+
+    class VertexArray
+    {
+    public:
         VertexArray()
         {
-            glCreateVertexArrays(1, &id);
+            id = backend().create_vertex_array();
         }
 
         ~VertexArray()
         {
-            glDeleteVertexArrays(1, &id);
+            state().delete_vertex_array(id);
         }
 
         inline auto bind() const -> void
         {
-            glBindVertexArray(id);
+            state().bind_vertex_array(id);
         }
 
         inline auto unbind() const -> void
         {
-            glBindVertexArray(0);
+            state().bind_vertex_array(0);
         }
 
         inline auto add_vertex_buffer(const std::shared_ptr<VertexBuffer> &vb) -> void
@@ -395,17 +1257,17 @@ namespace Graphics
             bind();
             vb->bind();
 
-            ASSERT(vb->layout.elements.size(), "VertexBuffer has no layout set");
+            add_attributes(vb->layout);
+            vbs.push_back(vb);
+        }
 
-            size_t offset{0};
-            for (size_t i = 0; i < vb->layout.elements.size(); i++)
-            {
-                const auto &e = vb->layout.elements[i];
-                glEnableVertexAttribArray(i);
-                glVertexAttribPointer(i, e.count, static_cast<unsigned int>(e.type),
-                                      e.normalized, vb->layout.stride, reinterpret_cast<const void *>(offset));
-                offset += e.size_of_type() * e.count;
-            }
+        inline auto add_vertex_buffer(const std::shared_ptr<StreamBuffer> &sb) -> void
+        {
+            bind();
+            sb->bind();
+
+            add_attributes(sb->get_layout());
+            streams.push_back(sb);
         }
 
         inline auto set_index_buffer(const std::shared_ptr<IndexBuffer> &ib) -> void
@@ -415,6 +1277,26 @@ namespace Graphics
             this->ib = ib;
         }
 
+        inline auto set_index_buffer(const std::shared_ptr<StreamBuffer> &sb) -> void
+        {
+            bind();
+            sb->bind();
+            index_stream = sb;
+        }
+
+        // Draws `instances` copies of `count` vertices (or indices, if an index buffer is set) starting at `first`.
+        // Per-instance attributes are read starting from `base_instance`, which needs GL 4.2 or ARB_base_instance
+        // (Window::make_current checks for it).
+        inline auto draw_instanced(Primitive primitive, size_t first, size_t count, size_t instances, size_t base_instance = 0) const -> void
+        {
+            bind();
+            if (ib || index_stream)
+                backend().draw_elements_instanced(static_cast<unsigned int>(primitive), count, GL_UNSIGNED_INT,
+                                                  first * sizeof(unsigned int), instances, base_instance);
+            else
+                backend().draw_arrays_instanced(static_cast<unsigned int>(primitive), first, count, instances, base_instance);
+        }
+
         inline auto get_vertex_buffers() const -> const std::vector<std::shared_ptr<VertexBuffer>> &
         {
             return vbs;
@@ -426,124 +1308,1306 @@ namespace Graphics
         }
 
     private:
+        inline auto add_attributes(const VertexBuffer::Layout &layout) -> void
+        {
+            ASSERT(layout.elements.size(), "VertexBuffer has no layout set");
+
+            // Attribute locations continue where the previous buffer's left off.
+            size_t offset{0};
+            for (const auto &e : layout.elements)
+            {
+                backend().vertex_attribute(attribute_count, e.count, static_cast<unsigned int>(e.type),
+                                           e.normalized, layout.stride, offset, layout.divisor);
+                offset += e.size_of_type() * e.count;
+                attribute_count++;
+            }
+        }
+
         unsigned int id;
+        unsigned int attribute_count{0};
         std::shared_ptr<IndexBuffer> ib;
         std::vector<std::shared_ptr<VertexBuffer>> vbs;
+        std::shared_ptr<StreamBuffer> index_stream;
+        std::vector<std::shared_ptr<StreamBuffer>> streams;
     };
 
-    class Shader
+    enum class TextureFormat
+    {
+        R8,
+        RGBA8,
+    };
+
+    class Texture2D
     {
     public:
-        Shader(const char *vertex_path, const char *fragment_path)
+        // `data` holds width * height tightly packed texels, the first row at texture coordinate t = 0.
+        Texture2D(size_t width, size_t height, TextureFormat format, const void *data) : width(width), height(height)
         {
-            // Read sources
-            std::ifstream vertex_f(vertex_path), fragment_f(fragment_path);
+            id = backend().create_texture();
+            bind();
 
-            ASSERT(vertex_f.is_open() && fragment_f.is_open(), "Source file failed to open");
-            std::stringstream vertex_stream, fragment_stream;
-            vertex_stream << vertex_f.rdbuf();
-            fragment_stream << fragment_f.rdbuf();
+            if (format == TextureFormat::R8)
+                backend().texture_image(width, height, GL_R8, GL_RED, data);
+            else
+                backend().texture_image(width, height, GL_RGBA8, GL_RGBA, data);
 
-            vertex_source = vertex_stream.str();
-            fragment_source = fragment_stream.str();
+            // Texel-exact sampling, e.g. for bitmap fonts
+            backend().texture_parameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            backend().texture_parameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            backend().texture_parameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            backend().texture_parameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
 
-            const char *vsptr = vertex_source.c_str();
-            const char *fsptr = fragment_source.c_str();
+        Texture2D(const Texture2D &) = delete;
+        Texture2D(Texture2D &&) = delete;
+        inline auto operator=(const Texture2D &) = delete;
+        inline auto operator=(Texture2D &&) = delete;
 
-            // Compile sources
-            unsigned int vertex, fragment;
+        ~Texture2D()
+        {
+            state().delete_texture(id);
+        }
 
-            int success;
-            char info[512];
+        inline auto bind(unsigned int unit = 0) const -> void
+        {
+            state().bind_texture(unit, id);
+        }
 
-            vertex = glCreateShader(GL_VERTEX_SHADER);
-            glShaderSource(vertex, 1, &vsptr, nullptr);
-            glCompileShader(vertex);
+        inline auto get_width() const -> size_t
+        {
+            return width;
+        }
 
-            glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-            glGetShaderInfoLog(vertex, 512, NULL, info);
-            ASSERT(success, info);
+        inline auto get_height() const -> size_t
+        {
+            return height;
+        }
 
-            fragment = glCreateShader(GL_FRAGMENT_SHADER);
-            glShaderSource(fragment, 1, &fsptr, nullptr);
-            glCompileShader(fragment);
+    private:
+        unsigned int id;
+        size_t width, height;
+    };
 
-            glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-            glGetShaderInfoLog(fragment, 512, NULL, info);
-            ASSERT(success, info);
+    struct Vec2
+    {
+        float x, y;
+    };
 
-            // Create shader program
-            id = glCreateProgram();
-            glAttachShader(id, vertex);
-            glAttachShader(id, fragment);
-            glLinkProgram(id);
+    struct Vec3
+    {
+        float x, y, z;
+    };
 
-            glGetProgramiv(id, GL_LINK_STATUS, &success);
-            glGetProgramInfoLog(id, 512, NULL, info);
+    struct Vec4
+    {
+        float x, y, z, w;
+    };
 
-            ASSERT(success, info);
+    // Column-major, like GLSL.
+    struct Mat3
+    {
+        float m[9];
+
+        static constexpr inline auto identity() -> Mat3
+        {
+            return {{1, 0, 0, 0, 1, 0, 0, 0, 1}};
+        }
+    };
 
-            glDeleteShader(vertex);
-            glDeleteShader(fragment);
+    // Column-major, like GLSL.
+    struct Mat4
+    {
+        float m[16];
 
-            vertex_f.close();
-            fragment_f.close();
+        static constexpr inline auto identity() -> Mat4
+        {
+            return {{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1}};
         }
 
-        ~Shader()
+        static constexpr inline auto ortho(float left, float right, float bottom, float top) -> Mat4
         {
-            glDeleteProgram(id);
+            return {{2 / (right - left), 0, 0, 0,
+                     0, 2 / (top - bottom), 0, 0,
+                     0, 0, -1, 0,
+                     -(right + left) / (right - left), -(top + bottom) / (top - bottom), 0, 1}};
         }
+    };
 
-        template <typename T>
-        inline auto set_uniform(const char *name, T value) -> void
+    struct Color
+    {
+        float r, g, b, a{1.0f};
+    };
+
+    // Position, rotation (in radians) and uniform scale of an object in world space.
+    struct Transform2D
+    {
+        float x{0}, y{0}, rotation{0}, scale{1};
+    };
+
+    namespace _impl
+    {
+        // 64-bit FNV-1a
+        constexpr inline auto fnv1a(std::string_view data, uint64_t hash = 14695981039346656037ull) -> uint64_t
         {
-            ASSERT(false, "Type specialization not implemented");
+            for (const char c : data)
+            {
+                hash ^= static_cast<unsigned char>(c);
+                hash *= 1099511628211ull;
+            }
+            return hash;
         }
+    }
 
-        inline auto bind() const -> void
+    // A uniform (or uniform block) name with its hash. Literals are hashed at compile time.
+    struct UniformName
+    {
+        template <size_t N>
+        consteval UniformName(const char (&name)[N]) : name(name), hash(_impl::fnv1a(std::string_view(name, N - 1)))
         {
-            glUseProgram(id);
         }
 
-        inline auto unbind() const -> void
+        // For names that are only known at run time.
+        static inline auto dynamic(const char *name) -> UniformName
         {
-            glUseProgram(0);
+            return UniformName(name, _impl::fnv1a(name));
         }
 
+        const char *name;
+        uint64_t hash;
+
     private:
-        inline auto uniform_location(const char *name) -> int
+        constexpr UniformName(const char *name, uint64_t hash) : name(name), hash(hash) {}
+    };
+
+    // GLSL sources of a shader program held in memory, e.g. embedded in the executable.
+    struct ShaderSource
+    {
+        const char *vertex, *fragment;
+    };
+
+    // Async compilation returns as soon as the driver has been handed the sources; with KHR_parallel_shader_compile the
+    // driver then works on them in the background and is_ready() tells when binding will not block.
+    enum class Compile
+    {
+        Blocking,
+        Async
+    };
+
+    class Shader
+    {
+    public:
+        Shader(const char *vertex_path, const char *fragment_path, Compile mode = Compile::Blocking)
         {
-            const auto itr = uniform_cache.find(name);
+            // Read sources
+            std::ifstream vertex_f(vertex_path), fragment_f(fragment_path);
 
-            if (itr != uniform_cache.end())
-            {
-                return itr->second;
-            }
-            else
-            {
-                auto location = glGetUniformLocation(id, name);
+            ASSERT(vertex_f.is_open() && fragment_f.is_open(), "Source file failed to open");
+            std::stringstream vertex_stream, fragment_stream;
+            vertex_stream << vertex_f.rdbuf();
+            fragment_stream << fragment_f.rdbuf();
+
+            vertex_source = vertex_stream.str();
+            fragment_source = fragment_stream.str();
 
-                ASSERT(location != -1, Log::format("Uniform with name %s does not exist.", name));
+            vertex_f.close();
+            fragment_f.close();
 
-                uniform_cache.emplace(name, location);
+            start(mode);
+        }
 
-                return location;
+        Shader(ShaderSource source, Compile mode = Compile::Blocking)
+            : vertex_source(source.vertex), fragment_source(source.fragment)
+        {
+            start(mode);
+        }
+
+        Shader(const Shader &) = delete;
+        Shader(Shader &&) = delete;
+        inline auto operator=(const Shader &) = delete;
+        inline auto operator=(Shader &&) = delete;
+
+        ~Shader()
+        {
+            if (not linked)
+            {
+                backend().delete_shader(vertex);
+                backend().delete_shader(fragment);
             }
+            state().delete_program(id);
         }
 
-        unsigned int id;
-        std::string vertex_source, fragment_source;
-        std::unordered_map<const char *, int> uniform_cache;
-    };
+        // Linked programs are stored in (and loaded from) this directory, keyed by a hash of the sources and the
+        // driver. An empty path disables the cache.
+        static inline auto set_binary_cache(std::string directory) -> void
+        {
+            binary_cache = std::move(directory);
+        }
 
-    // Specializations of Shader::set_uniform;
-    template <>
-    inline auto Shader::set_uniform<float>(const char *name, float value) -> void
-    {
-        glUniform1f(uniform_location(name), value);
-    }
+        // The program must be bound.
+        template <typename T>
+        inline auto set_uniform(UniformName name, const T &value) -> void
+        {
+            static_assert(sizeof(T) == 0, "Type specialization not implemented");
+        }
 
+        // Sets `count` consecutive elements of a uniform array. The program must be bound.
+        template <typename T>
+        inline auto set_uniform_array(UniformName name, const T *values, size_t count) -> void
+        {
+            static_assert(sizeof(T) == 0, "Type specialization not implemented");
+        }
+
+        // Connects a uniform block of the program to a UniformBuffer binding point.
+        inline auto bind_uniform_block(UniformName block, unsigned int binding) -> void
+        {
+            if (not linked)
+            {
+                // Applied once the program has linked, so async compiles are not forced to finish here.
+                pending_blocks.push_back({block, binding});
+                return;
+            }
+
+            const unsigned int index = backend().get_uniform_block_index(id, block.name);
+            ASSERT(index != GL_INVALID_INDEX, Log::format("Uniform block with name %s does not exist.", block.name).c_str());
+            backend().uniform_block_binding(id, index, binding);
+        }
+
+        // Whether the program can be used without waiting for the driver to finish compiling it.
+        inline auto is_ready() -> bool
+        {
+            if (linked || not backend().supports(Extension::ParallelShaderCompile))
+                return true;
+
+            return backend().get_program(id, GL_COMPLETION_STATUS_KHR);
+        }
+
+        // Blocks until compilation has finished if it has not yet.
+        inline auto bind() -> void
+        {
+            if (not linked)
+                finish();
+
+            state().use_program(id);
+        }
+
+        inline auto unbind() const -> void
+        {
+            state().use_program(0);
+        }
+
+    private:
+        inline auto start(Compile mode) -> void
+        {
+            started = std::chrono::steady_clock::now();
+
+            if (binary_cache_supported())
+            {
+                key = cache_key();
+                if (load_binary())
+                {
+                    linked = true;
+                    apply_pending_blocks();
+                    LOG_DEBUG("Loaded shader program %016llx from the binary cache in %.2f ms",
+                              static_cast<unsigned long long>(key), elapsed_ms());
+                    return;
+                }
+            }
+
+            if (mode == Compile::Async && backend().supports(Extension::ParallelShaderCompile))
+            {
+                // Let the driver use as many threads as it likes
+                static const bool threads_set = (backend().max_shader_compiler_threads(0xFFFFFFFFu), true);
+                (void)threads_set;
+            }
+
+            vertex = backend().create_shader(GL_VERTEX_SHADER);
+            backend().shader_source(vertex, vertex_source.c_str());
+            backend().compile_shader(vertex);
+
+            fragment = backend().create_shader(GL_FRAGMENT_SHADER);
+            backend().shader_source(fragment, fragment_source.c_str());
+            backend().compile_shader(fragment);
+
+            // Create shader program
+            id = backend().create_program();
+            backend().attach_shader(id, vertex);
+            backend().attach_shader(id, fragment);
+            if (key)
+                backend().program_parameter(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            backend().link_program(id);
+
+            // Status queries would wait for the compiler, so async compiles defer them.
+            if (mode == Compile::Blocking)
+                finish();
+        }
+
+        inline auto finish() -> void
+        {
+            int success;
+            char info[512];
+
+            success = backend().get_shader(vertex, GL_COMPILE_STATUS);
+            backend().get_shader_info_log(vertex, info, sizeof(info));
+            ASSERT(success, info);
+
+            success = backend().get_shader(fragment, GL_COMPILE_STATUS);
+            backend().get_shader_info_log(fragment, info, sizeof(info));
+            ASSERT(success, info);
+
+            success = backend().get_program(id, GL_LINK_STATUS);
+            backend().get_program_info_log(id, info, sizeof(info));
+
+            ASSERT(success, info);
+
+            backend().delete_shader(vertex);
+            backend().delete_shader(fragment);
+            linked = true;
+            apply_pending_blocks();
+
+            LOG_DEBUG("Compiled shader program in %.2f ms", elapsed_ms());
+
+            if (key)
+                store_binary();
+        }
+
+        static inline auto binary_cache_supported() -> bool
+        {
+            if (binary_cache.empty() || not backend().supports(Extension::ProgramBinary))
+                return false;
+
+            // Some drivers expose the extension without supporting a single binary format.
+            return backend().program_binary_formats() > 0;
+        }
+
+        // Binaries are only valid for the driver that produced them.
+        inline auto cache_key() const -> uint64_t
+        {
+            auto driver_string = [](unsigned int name) -> std::string_view
+            {
+                return backend().driver_string(name);
+            };
+
+            uint64_t hash = _impl::fnv1a(vertex_source);
+            hash = _impl::fnv1a(std::string_view("\0", 1), hash);
+            hash = _impl::fnv1a(fragment_source, hash);
+            hash = _impl::fnv1a(driver_string(GL_VENDOR), hash);
+            hash = _impl::fnv1a(driver_string(GL_RENDERER), hash);
+            hash = _impl::fnv1a(driver_string(GL_VERSION), hash);
+            return hash ? hash : 1;
+        }
+
+        inline auto cache_path() const -> std::string
+        {
+            char name[32];
+            std::snprintf(name, sizeof(name), "/%016llx.bin", static_cast<unsigned long long>(key));
+            return binary_cache + name;
+        }
+
+        // File layout: uint32 binary format, then the binary itself.
+        inline auto load_binary() -> bool
+        {
+            std::ifstream file(cache_path(), std::ios::binary);
+            if (not file.is_open())
+                return false;
+
+            const std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            if (data.size() <= sizeof(uint32_t))
+                return false;
+
+            uint32_t format;
+            std::memcpy(&format, data.data(), sizeof(format));
+
+            id = backend().create_program();
+            backend().program_binary(id, format, data.data() + sizeof(format), data.size() - sizeof(format));
+
+            // Rejected binaries (e.g. after a driver update) just fall back to compiling.
+            const int success = backend().get_program(id, GL_LINK_STATUS);
+            if (not success)
+            {
+                backend().delete_program(id);
+                id = 0;
+            }
+
+            return success;
+        }
+
+        inline auto store_binary() const -> void
+        {
+            const int length = backend().get_program(id, GL_PROGRAM_BINARY_LENGTH);
+            if (length <= 0)
+                return;
+
+            std::vector<char> data(sizeof(uint32_t) + length);
+            unsigned int format;
+            backend().get_program_binary(id, length, &format, data.data() + sizeof(uint32_t));
+            const uint32_t stored_format = format;
+            std::memcpy(data.data(), &stored_format, sizeof(stored_format));
+
+            // Written under a temporary name first, so a crash never leaves a truncated binary behind.
+            std::error_code error;
+            std::filesystem::create_directories(binary_cache, error);
+
+            const auto path = cache_path();
+            {
+                std::ofstream file(path + ".tmp", std::ios::binary | std::ios::trunc);
+                file.write(data.data(), data.size());
+                if (not file.good())
+                {
+                    LOG_WARN("Could not write shader binary %s", path.c_str());
+                    return;
+                }
+            }
+            std::filesystem::rename(path + ".tmp", path, error);
+        }
+
+        inline auto elapsed_ms() const -> double
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        }
+
+        inline auto apply_pending_blocks() -> void
+        {
+            for (const auto &[block, binding] : pending_blocks)
+                bind_uniform_block(block, binding);
+            pending_blocks.clear();
+        }
+
+        inline auto uniform_location(UniformName name) -> int
+        {
+            if (not linked)
+                finish();
+
+            const auto itr = uniform_cache.find(name.hash);
+
+            if (itr != uniform_cache.end())
+            {
+                return itr->second;
+            }
+            else
+            {
+                auto location = backend().get_uniform_location(id, name.name);
+
+                ASSERT(location != -1, Log::format("Uniform with name %s does not exist.", name.name).c_str());
+
+                uniform_cache.emplace(name.hash, location);
+
+                return location;
+            }
+        }
+
+        // Keys are hashes already
+        struct IdentityHash
+        {
+            inline auto operator()(uint64_t hash) const -> size_t
+            {
+                return static_cast<size_t>(hash);
+            }
+        };
+
+        static inline std::string binary_cache{};
+
+        unsigned int id{0}, vertex{0}, fragment{0};
+        bool linked{false};
+        uint64_t key{0};
+        std::chrono::steady_clock::time_point started;
+
+        std::string vertex_source, fragment_source;
+        std::unordered_map<uint64_t, int, IdentityHash> uniform_cache;
+        std::vector<std::pair<UniformName, unsigned int>> pending_blocks;
+    };
+
+    // Specializations of Shader::set_uniform;
+    template <>
+    inline auto Shader::set_uniform<int>(UniformName name, const int &value) -> void
+    {
+        backend().uniform(uniform_location(name), UniformType::Int, 1, &value);
+    }
+
+    template <>
+    inline auto Shader::set_uniform<float>(UniformName name, const float &value) -> void
+    {
+        backend().uniform(uniform_location(name), UniformType::Float, 1, &value);
+    }
+
+    template <>
+    inline auto Shader::set_uniform<Vec2>(UniformName name, const Vec2 &value) -> void
+    {
+        backend().uniform(uniform_location(name), UniformType::Vec2, 1, &value.x);
+    }
+
+    template <>
+    inline auto Shader::set_uniform<Vec3>(UniformName name, const Vec3 &value) -> void
+    {
+        backend().uniform(uniform_location(name), UniformType::Vec3, 1, &value.x);
+    }
+
+    template <>
+    inline auto Shader::set_uniform<Vec4>(UniformName name, const Vec4 &value) -> void
+    {
+        backend().uniform(uniform_location(name), UniformType::Vec4, 1, &value.x);
+    }
+
+    template <>
+    inline auto Shader::set_uniform<Color>(UniformName name, const Color &value) -> void
+    {
+        backend().uniform(uniform_location(name), UniformType::Vec4, 1, &value.r);
+    }
+
+    template <>
+    inline auto Shader::set_uniform<Mat3>(UniformName name, const Mat3 &value) -> void
+    {
+        backend().uniform(uniform_location(name), UniformType::Mat3, 1, value.m);
+    }
+
+    template <>
+    inline auto Shader::set_uniform<Mat4>(UniformName name, const Mat4 &value) -> void
+    {
+        backend().uniform(uniform_location(name), UniformType::Mat4, 1, value.m);
+    }
+
+    // Specializations of Shader::set_uniform_array;
+    template <>
+    inline auto Shader::set_uniform_array<int>(UniformName name, const int *values, size_t count) -> void
+    {
+        backend().uniform(uniform_location(name), UniformType::Int, count, values);
+    }
+
+    template <>
+    inline auto Shader::set_uniform_array<float>(UniformName name, const float *values, size_t count) -> void
+    {
+        backend().uniform(uniform_location(name), UniformType::Float, count, values);
+    }
+
+    template <>
+    inline auto Shader::set_uniform_array<Vec2>(UniformName name, const Vec2 *values, size_t count) -> void
+    {
+        backend().uniform(uniform_location(name), UniformType::Vec2, count, values);
+    }
+
+    template <>
+    inline auto Shader::set_uniform_array<Vec3>(UniformName name, const Vec3 *values, size_t count) -> void
+    {
+        backend().uniform(uniform_location(name), UniformType::Vec3, count, values);
+    }
+
+    template <>
+    inline auto Shader::set_uniform_array<Vec4>(UniformName name, const Vec4 *values, size_t count) -> void
+    {
+        backend().uniform(uniform_location(name), UniformType::Vec4, count, values);
+    }
+
+    template <>
+    inline auto Shader::set_uniform_array<Mat3>(UniformName name, const Mat3 *values, size_t count) -> void
+    {
+        backend().uniform(uniform_location(name), UniformType::Mat3, count, values);
+    }
+
+    template <>
+    inline auto Shader::set_uniform_array<Mat4>(UniformName name, const Mat4 *values, size_t count) -> void
+    {
+        backend().uniform(uniform_location(name), UniformType::Mat4, count, values);
+    }
+
+    /*
+    Block of uniforms shared by every program that binds a block to the same binding point. Data that is the same for
+    all draws of a frame (e.g. the view/projection matrix) is uploaded once instead of once per program and draw.
+    T must follow the std140 layout rules of the GLSL block it mirrors.
+    */
+    template <typename T>
+    class UniformBuffer
+    {
+    public:
+        UniformBuffer(unsigned int binding) : binding(binding)
+        {
+            id = backend().create_buffer();
+            state().bind_buffer(GL_UNIFORM_BUFFER, id);
+            backend().buffer_data(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+            backend().bind_buffer_base(GL_UNIFORM_BUFFER, binding, id);
+        }
+
+        UniformBuffer(const UniformBuffer &) = delete;
+        UniformBuffer(UniformBuffer &&) = delete;
+        inline auto operator=(const UniformBuffer &) = delete;
+        inline auto operator=(UniformBuffer &&) = delete;
+
+        ~UniformBuffer()
+        {
+            state().delete_buffer(id);
+        }
+
+        inline auto set(const T &value) -> void
+        {
+            state().bind_buffer(GL_UNIFORM_BUFFER, id);
+            backend().buffer_sub_data(GL_UNIFORM_BUFFER, 0, sizeof(T), &value);
+        }
+
+        inline auto get_binding() const -> unsigned int
+        {
+            return binding;
+        }
+
+    private:
+        unsigned int id;
+        unsigned int binding;
+    };
+
+    // Shared per-frame uniforms, "uniform Frame" in the renderers' shaders.
+    struct FrameUniforms
+    {
+        Mat4 view_projection;
+    };
+
+    constexpr unsigned int FRAME_UNIFORM_BINDING = 0;
+
+    /*
+    Collects the geometry of a whole frame in CPU-side staging arrays (already transformed to world space),
+    streams it into a StreamBuffer and draws it with one call per primitive type (at most two per frame).
+    World space is mapped to the screen by the view/projection matrix in the FrameUniforms buffer.
+    */
+    class BatchRenderer2D
+    {
+    public:
+        struct Vertex
+        {
+            float x, y;
+            float r, g, b, a;
+        };
+
+        struct Stats
+        {
+            size_t draw_calls{0};
+            size_t triangle_vertices{0}, line_vertices{0};
+            size_t uploaded_bytes{0};
+        };
+
+        static constexpr ShaderSource SHADER_SOURCE{
+            R"(#version 330 core
+layout(location = 0) in vec2 a_position;
+layout(location = 1) in vec4 a_color;
+layout(std140) uniform Frame
+{
+    mat4 u_view_projection;
+};
+out vec4 v_color;
+void main()
+{
+    v_color = a_color;
+    gl_Position = u_view_projection * vec4(a_position, 0.0, 1.0);
+})",
+            R"(#version 330 core
+in vec4 v_color;
+out vec4 color;
+void main()
+{
+    color = v_color;
+})"};
+
+        BatchRenderer2D(size_t initial_vertices = 1 << 14)
+            : stream(std::make_shared<StreamBuffer>(BufferTarget::Vertex, initial_vertices * sizeof(Vertex))),
+              shader(std::make_shared<Shader>(SHADER_SOURCE, Compile::Async))
+        {
+            stream->set_layout({{GLtype::Float, 2, false}, {GLtype::Float, 4, false}});
+            build();
+
+            shader->bind_uniform_block("Frame", FRAME_UNIFORM_BINDING);
+
+            triangles.reserve(initial_vertices);
+            lines.reserve(initial_vertices);
+        }
+
+        inline auto begin() -> void
+        {
+            triangles.clear();
+            lines.clear();
+        }
+
+        inline auto submit_line(Vec2 from, Vec2 to, Color color) -> void
+        {
+            lines.push_back({from.x, from.y, color.r, color.g, color.b, color.a});
+            lines.push_back({to.x, to.y, color.r, color.g, color.b, color.a});
+        }
+
+        // Pre-transformed vertices, three per triangle.
+        inline auto submit_triangles(const Vertex *vertices, size_t count) -> void
+        {
+            triangles.insert(triangles.end(), vertices, vertices + count);
+        }
+
+        // Pre-transformed vertices, two per line.
+        inline auto submit_lines(const Vertex *vertices, size_t count) -> void
+        {
+            lines.insert(lines.end(), vertices, vertices + count);
+        }
+
+        // Closed outline of a polygon given in model space.
+        inline auto submit_outline(const Vec2 *points, size_t count, const Transform2D &transform, Color color) -> void
+        {
+            if (count < 2)
+                return;
+
+            const Basis basis(transform);
+            const size_t first = lines.size();
+            lines.resize(first + 2 * count);
+
+            Vertex *out = lines.data() + first;
+            Vec2 prev = basis.apply(points[count - 1]);
+            for (size_t i = 0; i < count; i++)
+            {
+                const Vec2 curr = basis.apply(points[i]);
+                *out++ = {prev.x, prev.y, color.r, color.g, color.b, color.a};
+                *out++ = {curr.x, curr.y, color.r, color.g, color.b, color.a};
+                prev = curr;
+            }
+        }
+
+        // Filled convex polygon given in model space, triangulated as a fan.
+        inline auto submit_filled(const Vec2 *points, size_t count, const Transform2D &transform, Color color) -> void
+        {
+            if (count < 3)
+                return;
+
+            const Basis basis(transform);
+            const size_t first = triangles.size();
+            triangles.resize(first + 3 * (count - 2));
+
+            Vertex *out = triangles.data() + first;
+            const Vec2 origin = basis.apply(points[0]);
+            Vec2 prev = basis.apply(points[1]);
+            for (size_t i = 2; i < count; i++)
+            {
+                const Vec2 curr = basis.apply(points[i]);
+                *out++ = {origin.x, origin.y, color.r, color.g, color.b, color.a};
+                *out++ = {prev.x, prev.y, color.r, color.g, color.b, color.a};
+                *out++ = {curr.x, curr.y, color.r, color.g, color.b, color.a};
+                prev = curr;
+            }
+        }
+
+        // Uploads everything submitted since begin and draws it.
+        inline auto end() -> void
+        {
+            const size_t triangle_bytes = triangles.size() * sizeof(Vertex);
+            const size_t line_bytes = lines.size() * sizeof(Vertex);
+
+            stats = Stats{};
+            stats.triangle_vertices = triangles.size();
+            stats.line_vertices = lines.size();
+            stats.uploaded_bytes = triangle_bytes + line_bytes;
+
+            if (stats.uploaded_bytes == 0)
+                return;
+
+            // Both allocations may lose up to a vertex to alignment
+            const size_t needed = stats.uploaded_bytes + 2 * sizeof(Vertex);
+            if (needed > stream->get_region_size())
+            {
+                stream->reserve(2 * needed);
+                build();
+            }
+
+            size_t triangle_offset{0}, line_offset{0};
+            if (not triangles.empty())
+                stream->write(triangles.data(), triangle_bytes, sizeof(Vertex), triangle_offset);
+            if (not lines.empty())
+                stream->write(lines.data(), line_bytes, sizeof(Vertex), line_offset);
+
+            shader->bind();
+            va->bind();
+
+            if (not triangles.empty())
+            {
+                backend().draw_arrays(GL_TRIANGLES, triangle_offset / sizeof(Vertex), triangles.size());
+                stats.draw_calls++;
+            }
+
+            if (not lines.empty())
+            {
+                backend().draw_arrays(GL_LINES, line_offset / sizeof(Vertex), lines.size());
+                stats.draw_calls++;
+            }
+
+            stream->next_frame();
+        }
+
+        // Counters of the last frame that was ended.
+        inline auto get_stats() const -> const Stats &
+        {
+            return stats;
+        }
+
+        // Whether end() can draw without waiting for the shader to compile.
+        inline auto is_ready() const -> bool
+        {
+            return shader->is_ready();
+        }
+
+    private:
+        inline auto build() -> void
+        {
+            va = std::make_shared<VertexArray>();
+            va->add_vertex_buffer(stream);
+        }
+
+        // Model to world mapping with the trigonometry evaluated once per object.
+        struct Basis
+        {
+            Basis(const Transform2D &t)
+                : x(t.x), y(t.y), cos(t.scale * std::cos(t.rotation)), sin(t.scale * std::sin(t.rotation)) {}
+
+            inline auto apply(Vec2 p) const -> Vec2
+            {
+                return {x + cos * p.x - sin * p.y, y + sin * p.x + cos * p.y};
+            }
+
+            float x, y, cos, sin;
+        };
+
+        std::shared_ptr<StreamBuffer> stream;
+        std::shared_ptr<VertexArray> va;
+        std::shared_ptr<Shader> shader;
+
+        std::vector<Vertex> triangles, lines;
+        Stats stats;
+    };
+
+    /*
+    Draws many copies of a few template outlines. Template vertices are uploaded once; per frame only one Transform2D
+    per instance is uploaded, grouped by template, so every template in use costs one instanced draw call.
+    */
+    class InstancedRenderer2D
+    {
+    public:
+        using Vertex = BatchRenderer2D::Vertex;
+
+        struct Stats
+        {
+            size_t draw_calls{0};
+            size_t instances{0};
+            size_t uploaded_bytes{0};
+        };
+
+        static_assert(sizeof(Transform2D) == 4 * sizeof(float), "Transform2D is uploaded as a single vec4");
+
+        static constexpr ShaderSource SHADER_SOURCE{
+            R"(#version 330 core
+layout(location = 0) in vec2 a_position;
+layout(location = 1) in vec4 a_color;
+layout(location = 2) in vec4 i_transform; // x, y, rotation, scale
+layout(std140) uniform Frame
+{
+    mat4 u_view_projection;
+};
+out vec4 v_color;
+void main()
+{
+    float c = cos(i_transform.z) * i_transform.w, s = sin(i_transform.z) * i_transform.w;
+    vec2 position = i_transform.xy + vec2(c * a_position.x - s * a_position.y, s * a_position.x + c * a_position.y);
+    v_color = a_color;
+    gl_Position = u_view_projection * vec4(position, 0.0, 1.0);
+})",
+            BatchRenderer2D::SHADER_SOURCE.fragment};
+
+        InstancedRenderer2D(size_t initial_instances = 1 << 12)
+            : instance_stream(std::make_shared<StreamBuffer>(BufferTarget::Vertex, initial_instances * sizeof(Transform2D))),
+              shader(std::make_shared<Shader>(SHADER_SOURCE, Compile::Async))
+        {
+            instance_stream->set_layout({{GLtype::Float, 4, false}}, 1);
+            shader->bind_uniform_block("Frame", FRAME_UNIFORM_BINDING);
+        }
+
+        // Registers a closed outline given in model space, returns the id to submit instances of it with.
+        inline auto add_mesh(const Vec2 *points, size_t count, Color color) -> size_t
+        {
+            meshes.push_back({mesh_vertices.size(), count});
+            for (size_t i = 0; i < count; i++)
+                mesh_vertices.push_back({points[i].x, points[i].y, color.r, color.g, color.b, color.a});
+
+            instances.emplace_back();
+
+            // Rebuilt with the new template on the next end()
+            va.reset();
+            return meshes.size() - 1;
+        }
+
+        inline auto begin() -> void
+        {
+            for (auto &list : instances)
+                list.clear();
+        }
+
+        inline auto submit(size_t mesh, const Transform2D &transform) -> void
+        {
+            instances[mesh].push_back(transform);
+        }
+
+        // Bulk variant for transforms that are already contiguous, e.g. a component array.
+        inline auto submit(size_t mesh, const Transform2D *transforms, size_t count) -> void
+        {
+            instances[mesh].insert(instances[mesh].end(), transforms, transforms + count);
+        }
+
+        inline auto end() -> void
+        {
+            stats = Stats{};
+            for (const auto &list : instances)
+                stats.instances += list.size();
+
+            if (stats.instances == 0)
+                return;
+
+            stats.uploaded_bytes = stats.instances * sizeof(Transform2D);
+
+            // All templates' instances go into one allocation, back to back.
+            const auto allocation = instance_stream->allocate_instances<Transform2D>(stats.instances);
+            auto out = allocation.data;
+            for (const auto &list : instances)
+                out = std::copy(list.begin(), list.end(), out);
+            instance_stream->commit();
+
+            if (allocation.recreated)
+                va.reset();
+            if (not va)
+                build();
+
+            shader->bind();
+
+            size_t base_instance = allocation.base_instance;
+            for (size_t i = 0; i < meshes.size(); i++)
+            {
+                const auto &list = instances[i];
+                if (list.empty())
+                    continue;
+
+                va->draw_instanced(Primitive::LineLoop, meshes[i].first, meshes[i].count, list.size(), base_instance);
+
+                base_instance += list.size();
+                stats.draw_calls++;
+            }
+
+            instance_stream->next_frame();
+        }
+
+        // Counters of the last frame that was ended.
+        inline auto get_stats() const -> const Stats &
+        {
+            return stats;
+        }
+
+        // Whether end() can draw without waiting for the shader to compile.
+        inline auto is_ready() const -> bool
+        {
+            return shader->is_ready();
+        }
+
+    private:
+        struct Mesh
+        {
+            size_t first, count;
+        };
+
+        inline auto build() -> void
+        {
+            mesh_vb = std::make_shared<VertexBuffer>(mesh_vertices.data(), mesh_vertices.size() * sizeof(Vertex));
+            mesh_vb->set_layout({{GLtype::Float, 2, false}, {GLtype::Float, 4, false}});
+
+            va = std::make_shared<VertexArray>();
+            va->add_vertex_buffer(mesh_vb);
+            va->add_vertex_buffer(instance_stream);
+        }
+
+        std::shared_ptr<VertexBuffer> mesh_vb;
+        std::shared_ptr<StreamBuffer> instance_stream;
+        std::shared_ptr<VertexArray> va;
+        std::shared_ptr<Shader> shader;
+
+        std::vector<Vertex> mesh_vertices;
+        std::vector<Mesh> meshes;
+        std::vector<std::vector<Transform2D>> instances;
+        Stats stats;
+    };
+
+    /*
+    Draws text with the built-in bitmap font (Font.hpp). Every glyph of every string submitted between begin and end is
+    one instance of a quad that the vertex shader expands from gl_VertexID, so all of it goes into a single streaming
+    allocation and costs a single draw call.
+    */
+    class TextRenderer2D
+    {
+    public:
+        // Position of the glyph's top-left corner, its height and its index in the atlas.
+        struct Glyph
+        {
+            float x, y, size, index;
+            Color color;
+        };
+
+        struct Stats
+        {
+            size_t draw_calls{0};
+            size_t glyphs{0};
+            size_t uploaded_bytes{0};
+        };
+
+        static constexpr ShaderSource SHADER_SOURCE{
+            R"(#version 330 core
+layout(location = 0) in vec4 i_glyph; // x, y, size, atlas index
+layout(location = 1) in vec4 i_color;
+layout(std140) uniform Frame
+{
+    mat4 u_view_projection;
+};
+out vec2 v_uv;
+out vec4 v_color;
+const vec2 CORNERS[6] = vec2[](vec2(0, 0), vec2(1, 0), vec2(1, 1), vec2(0, 0), vec2(1, 1), vec2(0, 1));
+const vec2 CELL = vec2(6.0, 8.0), GLYPH = vec2(5.0, 7.0), ATLAS = vec2(96.0, 48.0);
+void main()
+{
+    vec2 corner = CORNERS[gl_VertexID];
+    int index = int(i_glyph.w);
+    vec2 cell = vec2(index % 16, index / 16) * CELL;
+    v_uv = (cell + corner * GLYPH) / ATLAS;
+    v_color = i_color;
+    vec2 position = i_glyph.xy + vec2(corner.x * GLYPH.x / GLYPH.y, -corner.y) * i_glyph.z;
+    gl_Position = u_view_projection * vec4(position, 0.0, 1.0);
+})",
+            R"(#version 330 core
+in vec2 v_uv;
+in vec4 v_color;
+uniform sampler2D u_atlas;
+out vec4 color;
+void main()
+{
+    if (texture(u_atlas, v_uv).r < 0.5)
+        discard;
+    color = v_color;
+})"};
+
+        static_assert(Font::ATLAS_COLUMNS == 16 && Font::ATLAS_WIDTH == 96 && Font::ATLAS_HEIGHT == 48,
+                      "SHADER_SOURCE hardcodes the atlas layout");
+
+        // Horizontal and vertical distance between glyphs, relative to the glyph height.
+        static constexpr float ADVANCE = static_cast<float>(Font::CELL_WIDTH) / Font::GLYPH_HEIGHT;
+        static constexpr float LINE_HEIGHT = static_cast<float>(Font::GLYPH_HEIGHT + 2) / Font::GLYPH_HEIGHT;
+
+        TextRenderer2D(size_t initial_glyphs = 1 << 10)
+            : instance_stream(std::make_shared<StreamBuffer>(BufferTarget::Vertex, initial_glyphs * sizeof(Glyph))),
+              shader(std::make_shared<Shader>(SHADER_SOURCE, Compile::Async)),
+              atlas(std::make_shared<Texture2D>(Font::ATLAS_WIDTH, Font::ATLAS_HEIGHT, TextureFormat::R8, Font::ATLAS.data()))
+        {
+            instance_stream->set_layout({{GLtype::Float, 4, false}, {GLtype::Float, 4, false}}, 1);
+            shader->bind_uniform_block("Frame", FRAME_UNIFORM_BINDING);
+
+            glyphs.reserve(initial_glyphs);
+        }
+
+        inline auto begin() -> void
+        {
+            glyphs.clear();
+        }
+
+        // Queues `text` with its first glyph's top-left corner at `position`, `size` world units high.
+        // '\n' starts a new line; spaces advance without emitting a glyph.
+        inline auto submit(std::string_view text, Vec2 position, float size, Color color) -> void
+        {
+            float x = position.x, y = position.y;
+            for (const char c : text)
+            {
+                if (c == '\n')
+                {
+                    x = position.x;
+                    y -= size * LINE_HEIGHT;
+                    continue;
+                }
+
+                if (c != ' ')
+                    glyphs.push_back({x, y, size, static_cast<float>(Font::glyph_index(c)), color});
+                x += size * ADVANCE;
+            }
+        }
+
+        // Uploads every glyph submitted since begin and draws them all at once.
+        inline auto end() -> void
+        {
+            stats = Stats{};
+            stats.glyphs = glyphs.size();
+            stats.uploaded_bytes = glyphs.size() * sizeof(Glyph);
+
+            if (glyphs.empty())
+                return;
+
+            const auto allocation = instance_stream->allocate_instances<Glyph>(glyphs.size());
+            std::copy(glyphs.begin(), glyphs.end(), allocation.data);
+            instance_stream->commit();
+
+            if (allocation.recreated)
+                va.reset();
+            if (not va)
+                build();
+
+            shader->bind();
+            if (not sampler_set)
+            {
+                shader->set_uniform<int>("u_atlas", 0);
+                sampler_set = true;
+            }
+            atlas->bind(0);
+
+            va->draw_instanced(Primitive::Triangles, 0, 6, glyphs.size(), allocation.base_instance);
+            stats.draw_calls++;
+
+            instance_stream->next_frame();
+        }
+
+        // Counters of the last frame that was ended.
+        inline auto get_stats() const -> const Stats &
+        {
+            return stats;
+        }
+
+        // Whether end() can draw without waiting for the shader to compile.
+        inline auto is_ready() const -> bool
+        {
+            return shader->is_ready();
+        }
+
+    private:
+        inline auto build() -> void
+        {
+            va = std::make_shared<VertexArray>();
+            va->add_vertex_buffer(instance_stream);
+        }
+
+        std::shared_ptr<StreamBuffer> instance_stream;
+        std::shared_ptr<VertexArray> va;
+        std::shared_ptr<Shader> shader;
+        std::shared_ptr<Texture2D> atlas;
+        bool sampler_set{false};
+
+        std::vector<Glyph> glyphs;
+        Stats stats;
+    };
+
+    /*
+    Draws particles as small squares. Each particle is one 20 byte instance of a quad that the vertex shader expands
+    from gl_VertexID; all particles of a frame go into one streaming allocation and cost a single draw call.
+    */
+    class ParticleRenderer2D
+    {
+    public:
+        // Center, edge length, remaining fraction of the lifetime (fades the color to black) and RGBA8 color.
+        struct Instance
+        {
+            float x, y, size, fade;
+            uint32_t color;
+        };
+
+        struct Stats
+        {
+            size_t draw_calls{0};
+            size_t particles{0};
+            size_t uploaded_bytes{0};
+        };
+
+        static constexpr ShaderSource SHADER_SOURCE{
+            R"(#version 330 core
+layout(location = 0) in vec4 i_particle; // x, y, size, fade
+layout(location = 1) in vec4 i_color;
+layout(std140) uniform Frame
+{
+    mat4 u_view_projection;
+};
+out vec4 v_color;
+const vec2 CORNERS[6] = vec2[](vec2(-0.5, -0.5), vec2(0.5, -0.5), vec2(0.5, 0.5), vec2(-0.5, -0.5), vec2(0.5, 0.5), vec2(-0.5, 0.5));
+void main()
+{
+    vec2 position = i_particle.xy + CORNERS[gl_VertexID] * i_particle.z;
+    v_color = vec4(i_color.rgb * i_particle.w, i_color.a);
+    gl_Position = u_view_projection * vec4(position, 0.0, 1.0);
+})",
+            BatchRenderer2D::SHADER_SOURCE.fragment};
+
+        static inline auto pack_color(Color color) -> uint32_t
+        {
+            auto channel = [](float value) -> uint32_t
+            {
+                return static_cast<uint32_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+            };
+
+            // Little-endian byte order, so r is the first byte in memory
+            return channel(color.r) | channel(color.g) << 8 | channel(color.b) << 16 | channel(color.a) << 24;
+        }
+
+        ParticleRenderer2D(size_t initial_particles = 1 << 14)
+            : instance_stream(std::make_shared<StreamBuffer>(BufferTarget::Vertex, initial_particles * sizeof(Instance))),
+              shader(std::make_shared<Shader>(SHADER_SOURCE, Compile::Async))
+        {
+            instance_stream->set_layout({{GLtype::Float, 4, false}, {GLtype::Byte, 4, true}}, 1);
+            shader->bind_uniform_block("Frame", FRAME_UNIFORM_BINDING);
+
+            instances.reserve(initial_particles);
+        }
+
+        inline auto begin() -> void
+        {
+            instances.clear();
+        }
+
+        inline auto submit(const Instance *particles, size_t count) -> void
+        {
+            instances.insert(instances.end(), particles, particles + count);
+        }
+
+        inline auto end() -> void
+        {
+            stats = Stats{};
+            stats.particles = instances.size();
+            stats.uploaded_bytes = instances.size() * sizeof(Instance);
+
+            if (instances.empty())
+                return;
+
+            const auto allocation = instance_stream->allocate_instances<Instance>(instances.size());
+            std::copy(instances.begin(), instances.end(), allocation.data);
+            instance_stream->commit();
+
+            if (allocation.recreated)
+                va.reset();
+            if (not va)
+                build();
+
+            shader->bind();
+            va->draw_instanced(Primitive::Triangles, 0, 6, instances.size(), allocation.base_instance);
+            stats.draw_calls++;
+
+            instance_stream->next_frame();
+        }
+
+        // Counters of the last frame that was ended.
+        inline auto get_stats() const -> const Stats &
+        {
+            return stats;
+        }
+
+        // Whether end() can draw without waiting for the shader to compile.
+        inline auto is_ready() const -> bool
+        {
+            return shader->is_ready();
+        }
+
+    private:
+        inline auto build() -> void
+        {
+            va = std::make_shared<VertexArray>();
+            va->add_vertex_buffer(instance_stream);
+        }
+
+        std::shared_ptr<StreamBuffer> instance_stream;
+        std::shared_ptr<VertexArray> va;
+        std::shared_ptr<Shader> shader;
+
+        std::vector<Instance> instances;
+        Stats stats;
+    };
 }
 
 #endif
\ No newline at end of file
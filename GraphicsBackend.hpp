@@ -0,0 +1,881 @@
+#ifndef GRAPHICS_BACKEND_HPP
+#define GRAPHICS_BACKEND_HPP
+
+#include "Error.hpp"
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+Every call the GL wrappers of Graphics.hpp make goes through the current Backend. GLBackend forwards to OpenGL,
+RecordingBackend needs no GL at all: it emulates buffers in memory and counts (and optionally traces) what a frame
+would have cost, so draw call, state change and upload budgets can be checked on machines without a GPU.
+*/
+
+namespace Graphics
+{
+    enum class Extension
+    {
+        BufferStorage,
+        ParallelShaderCompile,
+        ProgramBinary,
+    };
+
+    enum class UniformType
+    {
+        Int,
+        Float,
+        Vec2,
+        Vec3,
+        Vec4,
+        Mat3,
+        Mat4,
+    };
+
+    inline auto uniform_size(UniformType type) -> size_t
+    {
+        switch (type)
+        {
+        case UniformType::Int:
+            return sizeof(int);
+        case UniformType::Float:
+            return sizeof(float);
+        case UniformType::Vec2:
+            return 2 * sizeof(float);
+        case UniformType::Vec3:
+            return 3 * sizeof(float);
+        case UniformType::Vec4:
+            return 4 * sizeof(float);
+        case UniformType::Mat3:
+            return 9 * sizeof(float);
+        case UniformType::Mat4:
+            return 16 * sizeof(float);
+        default:
+            return 0;
+        }
+    }
+
+    class Backend
+    {
+    public:
+        virtual ~Backend() = default;
+
+        virtual inline auto supports(Extension extension) -> bool = 0;
+        virtual inline auto driver_string(unsigned int name) -> std::string_view = 0;
+
+        // Buffers
+        virtual inline auto create_buffer() -> unsigned int = 0;
+        virtual inline auto delete_buffer(unsigned int id) -> void = 0;
+        virtual inline auto bind_buffer(unsigned int target, unsigned int id) -> void = 0;
+        virtual inline auto bind_buffer_base(unsigned int target, unsigned int index, unsigned int id) -> void = 0;
+        virtual inline auto buffer_data(unsigned int target, size_t size, const void *data, unsigned int usage) -> void = 0;
+        virtual inline auto buffer_storage(unsigned int target, size_t size, unsigned int flags) -> void = 0;
+        virtual inline auto buffer_sub_data(unsigned int target, size_t offset, size_t size, const void *data) -> void = 0;
+        virtual inline auto map_buffer_range(unsigned int target, size_t offset, size_t size, unsigned int access) -> void * = 0;
+        virtual inline auto unmap_buffer(unsigned int target) -> void = 0;
+
+        // Textures, always GL_TEXTURE_2D. Texel data is tightly packed unsigned bytes.
+        virtual inline auto create_texture() -> unsigned int = 0;
+        virtual inline auto delete_texture(unsigned int id) -> void = 0;
+        virtual inline auto bind_texture(unsigned int unit, unsigned int id) -> void = 0;
+        virtual inline auto texture_image(size_t width, size_t height, unsigned int internal_format, unsigned int format, const void *data) -> void = 0;
+        virtual inline auto texture_parameter(unsigned int parameter, int value) -> void = 0;
+
+        // Synchronization
+        virtual inline auto fence() -> GLsync = 0;
+        // Returns whether the fence signalled within the timeout.
+        virtual inline auto wait_fence(GLsync fence, bool flush, uint64_t timeout_ns) -> bool = 0;
+        virtual inline auto delete_fence(GLsync fence) -> void = 0;
+
+        // Vertex arrays
+        virtual inline auto create_vertex_array() -> unsigned int = 0;
+        virtual inline auto delete_vertex_array(unsigned int id) -> void = 0;
+        virtual inline auto bind_vertex_array(unsigned int id) -> void = 0;
+        // Enables the attribute and sets its pointer and divisor.
+        virtual inline auto vertex_attribute(unsigned int index, size_t count, unsigned int type, bool normalized,
+                                             size_t stride, size_t offset, unsigned int divisor) -> void = 0;
+
+        // Shaders and programs
+        virtual inline auto create_shader(unsigned int type) -> unsigned int = 0;
+        virtual inline auto shader_source(unsigned int shader, const char *source) -> void = 0;
+        virtual inline auto compile_shader(unsigned int shader) -> void = 0;
+        virtual inline auto get_shader(unsigned int shader, unsigned int parameter) -> int = 0;
+        virtual inline auto get_shader_info_log(unsigned int shader, char *info, size_t size) -> void = 0;
+        virtual inline auto delete_shader(unsigned int shader) -> void = 0;
+        virtual inline auto max_shader_compiler_threads(unsigned int count) -> void = 0;
+
+        virtual inline auto create_program() -> unsigned int = 0;
+        virtual inline auto attach_shader(unsigned int program, unsigned int shader) -> void = 0;
+        virtual inline auto program_parameter(unsigned int program, unsigned int parameter, int value) -> void = 0;
+        virtual inline auto link_program(unsigned int program) -> void = 0;
+        virtual inline auto get_program(unsigned int program, unsigned int parameter) -> int = 0;
+        virtual inline auto get_program_info_log(unsigned int program, char *info, size_t size) -> void = 0;
+        virtual inline auto delete_program(unsigned int program) -> void = 0;
+        virtual inline auto use_program(unsigned int program) -> void = 0;
+
+        virtual inline auto program_binary_formats() -> int = 0;
+        virtual inline auto get_program_binary(unsigned int program, size_t size, unsigned int *format, void *binary) -> void = 0;
+        virtual inline auto program_binary(unsigned int program, unsigned int format, const void *binary, size_t size) -> void = 0;
+
+        // Uniforms
+        virtual inline auto get_uniform_location(unsigned int program, const char *name) -> int = 0;
+        virtual inline auto get_uniform_block_index(unsigned int program, const char *name) -> unsigned int = 0;
+        virtual inline auto uniform_block_binding(unsigned int program, unsigned int index, unsigned int binding) -> void = 0;
+        virtual inline auto uniform(int location, UniformType type, size_t count, const void *values) -> void = 0;
+
+        // Frame
+        virtual inline auto clear(float r, float g, float b, float a) -> void = 0;
+        virtual inline auto viewport(int x, int y, int width, int height) -> void = 0;
+        virtual inline auto draw_arrays(unsigned int mode, size_t first, size_t count) -> void = 0;
+        virtual inline auto draw_arrays_instanced(unsigned int mode, size_t first, size_t count, size_t instances, size_t base_instance) -> void = 0;
+        virtual inline auto draw_elements_instanced(unsigned int mode, size_t count, unsigned int type, size_t offset, size_t instances, size_t base_instance) -> void = 0;
+
+        // Called by the presenting thread once per frame.
+        virtual inline auto end_frame() -> void {}
+    };
+
+    class GLBackend : public Backend
+    {
+    public:
+        virtual inline auto supports(Extension extension) -> bool override
+        {
+            switch (extension)
+            {
+            case Extension::BufferStorage:
+                return GLEW_ARB_buffer_storage;
+            case Extension::ParallelShaderCompile:
+                return GLEW_KHR_parallel_shader_compile;
+            case Extension::ProgramBinary:
+                return GLEW_ARB_get_program_binary;
+            default:
+                return false;
+            }
+        }
+
+        virtual inline auto driver_string(unsigned int name) -> std::string_view override
+        {
+            const auto str = reinterpret_cast<const char *>(glGetString(name));
+            return str ? str : "";
+        }
+
+        virtual inline auto create_buffer() -> unsigned int override
+        {
+            unsigned int id;
+            glGenBuffers(1, &id);
+            return id;
+        }
+
+        virtual inline auto delete_buffer(unsigned int id) -> void override
+        {
+            glDeleteBuffers(1, &id);
+        }
+
+        virtual inline auto bind_buffer(unsigned int target, unsigned int id) -> void override
+        {
+            glBindBuffer(target, id);
+        }
+
+        virtual inline auto bind_buffer_base(unsigned int target, unsigned int index, unsigned int id) -> void override
+        {
+            glBindBufferBase(target, index, id);
+        }
+
+        virtual inline auto buffer_data(unsigned int target, size_t size, const void *data, unsigned int usage) -> void override
+        {
+            glBufferData(target, size, data, usage);
+        }
+
+        virtual inline auto buffer_storage(unsigned int target, size_t size, unsigned int flags) -> void override
+        {
+            glBufferStorage(target, size, nullptr, flags);
+        }
+
+        virtual inline auto buffer_sub_data(unsigned int target, size_t offset, size_t size, const void *data) -> void override
+        {
+            glBufferSubData(target, offset, size, data);
+        }
+
+        virtual inline auto map_buffer_range(unsigned int target, size_t offset, size_t size, unsigned int access) -> void * override
+        {
+            return glMapBufferRange(target, offset, size, access);
+        }
+
+        virtual inline auto unmap_buffer(unsigned int target) -> void override
+        {
+            glUnmapBuffer(target);
+        }
+
+        virtual inline auto create_texture() -> unsigned int override
+        {
+            unsigned int id;
+            glGenTextures(1, &id);
+            return id;
+        }
+
+        virtual inline auto delete_texture(unsigned int id) -> void override
+        {
+            glDeleteTextures(1, &id);
+        }
+
+        virtual inline auto bind_texture(unsigned int unit, unsigned int id) -> void override
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(GL_TEXTURE_2D, id);
+        }
+
+        virtual inline auto texture_image(size_t width, size_t height, unsigned int internal_format, unsigned int format, const void *data) -> void override
+        {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        }
+
+        virtual inline auto texture_parameter(unsigned int parameter, int value) -> void override
+        {
+            glTexParameteri(GL_TEXTURE_2D, parameter, value);
+        }
+
+        virtual inline auto fence() -> GLsync override
+        {
+            return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+
+        virtual inline auto wait_fence(GLsync fence, bool flush, uint64_t timeout_ns) -> bool override
+        {
+            return glClientWaitSync(fence, flush ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout_ns) != GL_TIMEOUT_EXPIRED;
+        }
+
+        virtual inline auto delete_fence(GLsync fence) -> void override
+        {
+            glDeleteSync(fence);
+        }
+
+        virtual inline auto create_vertex_array() -> unsigned int override
+        {
+            unsigned int id;
+            glCreateVertexArrays(1, &id);
+            return id;
+        }
+
+        virtual inline auto delete_vertex_array(unsigned int id) -> void override
+        {
+            glDeleteVertexArrays(1, &id);
+        }
+
+        virtual inline auto bind_vertex_array(unsigned int id) -> void override
+        {
+            glBindVertexArray(id);
+        }
+
+        virtual inline auto vertex_attribute(unsigned int index, size_t count, unsigned int type, bool normalized,
+                                             size_t stride, size_t offset, unsigned int divisor) -> void override
+        {
+            glEnableVertexAttribArray(index);
+            glVertexAttribPointer(index, count, type, normalized, stride, reinterpret_cast<const void *>(offset));
+            glVertexAttribDivisor(index, divisor);
+        }
+
+        virtual inline auto create_shader(unsigned int type) -> unsigned int override
+        {
+            return glCreateShader(type);
+        }
+
+        virtual inline auto shader_source(unsigned int shader, const char *source) -> void override
+        {
+            glShaderSource(shader, 1, &source, nullptr);
+        }
+
+        virtual inline auto compile_shader(unsigned int shader) -> void override
+        {
+            glCompileShader(shader);
+        }
+
+        virtual inline auto get_shader(unsigned int shader, unsigned int parameter) -> int override
+        {
+            int value{0};
+            glGetShaderiv(shader, parameter, &value);
+            return value;
+        }
+
+        virtual inline auto get_shader_info_log(unsigned int shader, char *info, size_t size) -> void override
+        {
+            glGetShaderInfoLog(shader, size, nullptr, info);
+        }
+
+        virtual inline auto delete_shader(unsigned int shader) -> void override
+        {
+            glDeleteShader(shader);
+        }
+
+        virtual inline auto max_shader_compiler_threads(unsigned int count) -> void override
+        {
+            glMaxShaderCompilerThreadsKHR(count);
+        }
+
+        virtual inline auto create_program() -> unsigned int override
+        {
+            return glCreateProgram();
+        }
+
+        virtual inline auto attach_shader(unsigned int program, unsigned int shader) -> void override
+        {
+            glAttachShader(program, shader);
+        }
+
+        virtual inline auto program_parameter(unsigned int program, unsigned int parameter, int value) -> void override
+        {
+            glProgramParameteri(program, parameter, value);
+        }
+
+        virtual inline auto link_program(unsigned int program) -> void override
+        {
+            glLinkProgram(program);
+        }
+
+        virtual inline auto get_program(unsigned int program, unsigned int parameter) -> int override
+        {
+            int value{0};
+            glGetProgramiv(program, parameter, &value);
+            return value;
+        }
+
+        virtual inline auto get_program_info_log(unsigned int program, char *info, size_t size) -> void override
+        {
+            glGetProgramInfoLog(program, size, nullptr, info);
+        }
+
+        virtual inline auto delete_program(unsigned int program) -> void override
+        {
+            glDeleteProgram(program);
+        }
+
+        virtual inline auto use_program(unsigned int program) -> void override
+        {
+            glUseProgram(program);
+        }
+
+        virtual inline auto program_binary_formats() -> int override
+        {
+            int formats{0};
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            return formats;
+        }
+
+        virtual inline auto get_program_binary(unsigned int program, size_t size, unsigned int *format, void *binary) -> void override
+        {
+            glGetProgramBinary(program, size, nullptr, format, binary);
+        }
+
+        virtual inline auto program_binary(unsigned int program, unsigned int format, const void *binary, size_t size) -> void override
+        {
+            glProgramBinary(program, format, binary, size);
+        }
+
+        virtual inline auto get_uniform_location(unsigned int program, const char *name) -> int override
+        {
+            return glGetUniformLocation(program, name);
+        }
+
+        virtual inline auto get_uniform_block_index(unsigned int program, const char *name) -> unsigned int override
+        {
+            return glGetUniformBlockIndex(program, name);
+        }
+
+        virtual inline auto uniform_block_binding(unsigned int program, unsigned int index, unsigned int binding) -> void override
+        {
+            glUniformBlockBinding(program, index, binding);
+        }
+
+        virtual inline auto uniform(int location, UniformType type, size_t count, const void *values) -> void override
+        {
+            const auto ints = static_cast<const int *>(values);
+            const auto floats = static_cast<const float *>(values);
+
+            switch (type)
+            {
+            case UniformType::Int:
+                glUniform1iv(location, count, ints);
+                break;
+            case UniformType::Float:
+                glUniform1fv(location, count, floats);
+                break;
+            case UniformType::Vec2:
+                glUniform2fv(location, count, floats);
+                break;
+            case UniformType::Vec3:
+                glUniform3fv(location, count, floats);
+                break;
+            case UniformType::Vec4:
+                glUniform4fv(location, count, floats);
+                break;
+            case UniformType::Mat3:
+                glUniformMatrix3fv(location, count, GL_FALSE, floats);
+                break;
+            case UniformType::Mat4:
+                glUniformMatrix4fv(location, count, GL_FALSE, floats);
+                break;
+            }
+        }
+
+        virtual inline auto clear(float r, float g, float b, float a) -> void override
+        {
+            glClearColor(r, g, b, a);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+
+        virtual inline auto viewport(int x, int y, int width, int height) -> void override
+        {
+            glViewport(x, y, width, height);
+        }
+
+        virtual inline auto draw_arrays(unsigned int mode, size_t first, size_t count) -> void override
+        {
+            glDrawArrays(mode, first, count);
+        }
+
+        virtual inline auto draw_arrays_instanced(unsigned int mode, size_t first, size_t count, size_t instances, size_t base_instance) -> void override
+        {
+            glDrawArraysInstancedBaseInstance(mode, first, count, instances, base_instance);
+        }
+
+        virtual inline auto draw_elements_instanced(unsigned int mode, size_t count, unsigned int type, size_t offset, size_t instances, size_t base_instance) -> void override
+        {
+            glDrawElementsInstancedBaseInstance(mode, count, type, reinterpret_cast<const void *>(offset), instances, base_instance);
+        }
+    };
+
+    /*
+    Software stand-in for the GL: buffers live in memory (so mapped writes work), shaders always compile and link,
+    and nothing is drawn. Every call is counted; with tracing enabled it is also kept, with its byte size, until the
+    end of the frame. Reports no extensions, so streaming goes through explicit (measurable) map calls.
+    */
+    class RecordingBackend : public Backend
+    {
+    public:
+        struct Call
+        {
+            const char *name;
+            size_t bytes;
+        };
+
+        struct Counters
+        {
+            size_t calls{0};
+            size_t draw_calls{0};
+            size_t state_changes{0};
+            size_t uploaded_bytes{0};
+            size_t allocated_bytes{0};
+        };
+
+        // Keep every call of the frame (see get_trace), not just the counters.
+        inline auto set_tracing(bool value) -> RecordingBackend &
+        {
+            tracing = value;
+            return *this;
+        }
+
+        // Counters of the last completed frame.
+        inline auto get_frame_counters() const -> const Counters &
+        {
+            return last_frame;
+        }
+
+        // Totals since creation.
+        inline auto get_total_counters() const -> const Counters &
+        {
+            return total;
+        }
+
+        // Calls of the last completed frame, if tracing.
+        inline auto get_trace() const -> const std::vector<Call> &
+        {
+            return last_trace;
+        }
+
+        inline auto dump(const Log::Logger &logger = Log::debug) const -> void
+        {
+            if (not logger.is_active())
+                return;
+
+            for (const auto &call : last_trace)
+                logger(Log::format("%s (%zu bytes)", call.name, call.bytes));
+        }
+
+        virtual inline auto end_frame() -> void override
+        {
+            last_frame = frame;
+            frame = Counters{};
+
+            last_trace.swap(trace);
+            trace.clear();
+        }
+
+        virtual inline auto supports(Extension) -> bool override
+        {
+            return false;
+        }
+
+        virtual inline auto driver_string(unsigned int) -> std::string_view override
+        {
+            return "RecordingBackend";
+        }
+
+        virtual inline auto create_buffer() -> unsigned int override
+        {
+            record("create_buffer");
+            buffers[next_id];
+            return next_id++;
+        }
+
+        virtual inline auto delete_buffer(unsigned int id) -> void override
+        {
+            record("delete_buffer");
+            buffers.erase(id);
+            for (auto &[target, bound] : bound_buffers)
+            {
+                if (bound == id)
+                    bound = 0;
+            }
+        }
+
+        virtual inline auto bind_buffer(unsigned int target, unsigned int id) -> void override
+        {
+            record("bind_buffer", 0, State);
+            bound_buffers[target] = id;
+        }
+
+        virtual inline auto bind_buffer_base(unsigned int target, unsigned int, unsigned int id) -> void override
+        {
+            record("bind_buffer_base", 0, State);
+            bound_buffers[target] = id;
+        }
+
+        virtual inline auto buffer_data(unsigned int target, size_t size, const void *data, unsigned int) -> void override
+        {
+            record("buffer_data", data ? size : 0, Upload);
+            frame.allocated_bytes += size;
+            total.allocated_bytes += size;
+
+            auto &storage = bound(target);
+            storage.assign(size, 0);
+            if (data)
+                std::memcpy(storage.data(), data, size);
+        }
+
+        virtual inline auto buffer_storage(unsigned int target, size_t size, unsigned int) -> void override
+        {
+            record("buffer_storage");
+            frame.allocated_bytes += size;
+            total.allocated_bytes += size;
+            bound(target).assign(size, 0);
+        }
+
+        virtual inline auto buffer_sub_data(unsigned int target, size_t offset, size_t size, const void *data) -> void override
+        {
+            record("buffer_sub_data", size, Upload);
+
+            auto &storage = bound(target);
+            ASSERT(offset + size <= storage.size(), "buffer_sub_data past the end of the buffer");
+            std::memcpy(storage.data() + offset, data, size);
+        }
+
+        // Mapped ranges are counted as uploaded in full.
+        virtual inline auto map_buffer_range(unsigned int target, size_t offset, size_t size, unsigned int) -> void * override
+        {
+            record("map_buffer_range", size, Upload);
+
+            auto &storage = bound(target);
+            ASSERT(offset + size <= storage.size(), "map_buffer_range past the end of the buffer");
+            return storage.data() + offset;
+        }
+
+        virtual inline auto unmap_buffer(unsigned int) -> void override
+        {
+            record("unmap_buffer");
+        }
+
+        virtual inline auto create_texture() -> unsigned int override
+        {
+            record("create_texture");
+            return next_id++;
+        }
+
+        virtual inline auto delete_texture(unsigned int) -> void override
+        {
+            record("delete_texture");
+        }
+
+        virtual inline auto bind_texture(unsigned int, unsigned int) -> void override
+        {
+            record("bind_texture", 0, State);
+        }
+
+        virtual inline auto texture_image(size_t width, size_t height, unsigned int, unsigned int format, const void *data) -> void override
+        {
+            const size_t channels = format == GL_RED ? 1 : format == GL_RG ? 2 : format == GL_RGB ? 3 : 4;
+            const size_t size = width * height * channels;
+
+            record("texture_image", data ? size : 0, Upload);
+            frame.allocated_bytes += size;
+            total.allocated_bytes += size;
+        }
+
+        virtual inline auto texture_parameter(unsigned int, int) -> void override
+        {
+            record("texture_parameter");
+        }
+
+        virtual inline auto fence() -> GLsync override
+        {
+            record("fence");
+            return reinterpret_cast<GLsync>(static_cast<uintptr_t>(next_id++));
+        }
+
+        virtual inline auto wait_fence(GLsync, bool, uint64_t) -> bool override
+        {
+            record("wait_fence");
+            return true;
+        }
+
+        virtual inline auto delete_fence(GLsync) -> void override
+        {
+            record("delete_fence");
+        }
+
+        virtual inline auto create_vertex_array() -> unsigned int override
+        {
+            record("create_vertex_array");
+            return next_id++;
+        }
+
+        virtual inline auto delete_vertex_array(unsigned int) -> void override
+        {
+            record("delete_vertex_array");
+        }
+
+        virtual inline auto bind_vertex_array(unsigned int) -> void override
+        {
+            record("bind_vertex_array", 0, State);
+        }
+
+        virtual inline auto vertex_attribute(unsigned int, size_t, unsigned int, bool, size_t, size_t, unsigned int) -> void override
+        {
+            record("vertex_attribute", 0, State);
+        }
+
+        virtual inline auto create_shader(unsigned int) -> unsigned int override
+        {
+            record("create_shader");
+            return next_id++;
+        }
+
+        virtual inline auto shader_source(unsigned int, const char *source) -> void override
+        {
+            record("shader_source", std::strlen(source));
+        }
+
+        virtual inline auto compile_shader(unsigned int) -> void override
+        {
+            record("compile_shader");
+        }
+
+        // Everything compiles, links and is ready immediately.
+        virtual inline auto get_shader(unsigned int, unsigned int parameter) -> int override
+        {
+            record("get_shader");
+            return parameter == GL_INFO_LOG_LENGTH ? 0 : 1;
+        }
+
+        virtual inline auto get_shader_info_log(unsigned int, char *info, size_t size) -> void override
+        {
+            record("get_shader_info_log");
+            if (size)
+                info[0] = '\0';
+        }
+
+        virtual inline auto delete_shader(unsigned int) -> void override
+        {
+            record("delete_shader");
+        }
+
+        virtual inline auto max_shader_compiler_threads(unsigned int) -> void override
+        {
+            record("max_shader_compiler_threads");
+        }
+
+        virtual inline auto create_program() -> unsigned int override
+        {
+            record("create_program");
+            return next_id++;
+        }
+
+        virtual inline auto attach_shader(unsigned int, unsigned int) -> void override
+        {
+            record("attach_shader");
+        }
+
+        virtual inline auto program_parameter(unsigned int, unsigned int, int) -> void override
+        {
+            record("program_parameter");
+        }
+
+        virtual inline auto link_program(unsigned int) -> void override
+        {
+            record("link_program");
+        }
+
+        virtual inline auto get_program(unsigned int, unsigned int parameter) -> int override
+        {
+            record("get_program");
+            return parameter == GL_INFO_LOG_LENGTH || parameter == GL_PROGRAM_BINARY_LENGTH ? 0 : 1;
+        }
+
+        virtual inline auto get_program_info_log(unsigned int, char *info, size_t size) -> void override
+        {
+            record("get_program_info_log");
+            if (size)
+                info[0] = '\0';
+        }
+
+        virtual inline auto delete_program(unsigned int) -> void override
+        {
+            record("delete_program");
+        }
+
+        virtual inline auto use_program(unsigned int) -> void override
+        {
+            record("use_program", 0, State);
+        }
+
+        virtual inline auto program_binary_formats() -> int override
+        {
+            return 0;
+        }
+
+        virtual inline auto get_program_binary(unsigned int, size_t, unsigned int *, void *) -> void override
+        {
+            record("get_program_binary");
+        }
+
+        virtual inline auto program_binary(unsigned int, unsigned int, const void *, size_t size) -> void override
+        {
+            record("program_binary", size);
+        }
+
+        virtual inline auto get_uniform_location(unsigned int, const char *) -> int override
+        {
+            record("get_uniform_location");
+            return next_location++;
+        }
+
+        virtual inline auto get_uniform_block_index(unsigned int, const char *) -> unsigned int override
+        {
+            record("get_uniform_block_index");
+            return 0;
+        }
+
+        virtual inline auto uniform_block_binding(unsigned int, unsigned int, unsigned int) -> void override
+        {
+            record("uniform_block_binding");
+        }
+
+        virtual inline auto uniform(int, UniformType type, size_t count, const void *) -> void override
+        {
+            record("uniform", count * uniform_size(type), Upload);
+        }
+
+        virtual inline auto clear(float, float, float, float) -> void override
+        {
+            record("clear");
+        }
+
+        virtual inline auto viewport(int, int, int, int) -> void override
+        {
+            record("viewport", 0, State);
+        }
+
+        virtual inline auto draw_arrays(unsigned int, size_t, size_t) -> void override
+        {
+            record("draw_arrays", 0, Draw);
+        }
+
+        virtual inline auto draw_arrays_instanced(unsigned int, size_t, size_t, size_t, size_t) -> void override
+        {
+            record("draw_arrays_instanced", 0, Draw);
+        }
+
+        virtual inline auto draw_elements_instanced(unsigned int, size_t, unsigned int, size_t, size_t, size_t) -> void override
+        {
+            record("draw_elements_instanced", 0, Draw);
+        }
+
+    private:
+        enum Kind
+        {
+            Other,
+            State,
+            Upload,
+            Draw
+        };
+
+        inline auto record(const char *name, size_t bytes = 0, Kind kind = Other) -> void
+        {
+            for (auto counters : {&frame, &total})
+            {
+                counters->calls++;
+                counters->draw_calls += kind == Draw;
+                counters->state_changes += kind == State;
+                counters->uploaded_bytes += kind == Upload ? bytes : 0;
+            }
+
+            if (tracing)
+                trace.push_back({name, bytes});
+        }
+
+        inline auto bound(unsigned int target) -> std::vector<char> &
+        {
+            const auto id = bound_buffers[target];
+            ASSERT(buffers.count(id), "No buffer bound to target");
+            return buffers[id];
+        }
+
+        std::unordered_map<unsigned int, std::vector<char>> buffers;
+        std::unordered_map<unsigned int, unsigned int> bound_buffers;
+        unsigned int next_id{1};
+        int next_location{0};
+
+        bool tracing{false};
+        std::vector<Call> trace, last_trace;
+        Counters frame, last_frame, total;
+    };
+
+    namespace _impl
+    {
+        inline auto backend_instance() -> std::shared_ptr<Backend> &
+        {
+            static std::shared_ptr<Backend> instance = std::make_shared<GLBackend>();
+            return instance;
+        }
+    }
+
+    // The backend all GL wrappers talk to.
+    inline auto backend() -> Backend &
+    {
+        return *_impl::backend_instance();
+    }
+
+    // Must happen before any GL object is created, and not while another thread renders.
+    inline auto set_backend(std::shared_ptr<Backend> backend) -> void
+    {
+        _impl::backend_instance() = std::move(backend);
+    }
+}
+
+#endif
@@ -10,6 +10,9 @@ namespace Input
     inline auto is_pressed(Key key) -> bool
     {
         auto window_handle = App::Application::get_instance().get_window().get_native_handle();
+        if (not window_handle)
+            return false;
+
         const auto state = glfwGetKey(window_handle, static_cast<int>(key));
         return state == GLFW_PRESS || state == GLFW_REPEAT;
     }
@@ -17,6 +20,9 @@ namespace Input
     inline auto is_pressed(Mouse button) -> bool
     {
         auto window_handle = App::Application::get_instance().get_window().get_native_handle();
+        if (not window_handle)
+            return false;
+
         const auto state = glfwGetMouseButton(window_handle, static_cast<int>(button));
         return state == GLFW_PRESS;
     }
@@ -25,8 +31,9 @@ namespace Input
     {
         auto window_handle = App::Application::get_instance().get_window().get_native_handle();
 
-        double x, y;
-        glfwGetCursorPos(window_handle, &x, &y);
+        double x{0}, y{0};
+        if (window_handle)
+            glfwGetCursorPos(window_handle, &x, &y);
         return std::make_pair(x, y);
     }
 }
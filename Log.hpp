@@ -5,7 +5,21 @@
 #include <iomanip>
 #include <ctime>
 #include <cstdarg>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <algorithm>
 #include <bitset>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <sstream>
+#include <string_view>
+#include <vector>
 
 /*
 TODO: Clean this up
@@ -16,6 +30,60 @@ TODO: Documentation
 #define DEFAULT_DATETIME_FORMAT "[%Y-%m-%d %H:%M:%S]"
 #endif
 
+// Log calls made through the LOG_* macros below this level are compiled out entirely.
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
+#endif
+
+// Arguments are only evaluated (and formatted) when the level survives compilation and the logger is active.
+#define LOG_AT(logger, level, ...)                     \
+    do                                                 \
+    {                                                  \
+        if constexpr ((level) >= LOG_COMPILE_LEVEL)    \
+        {                                              \
+            if ((logger).is_active())                  \
+                (logger)(Log::format(__VA_ARGS__));    \
+        }                                              \
+    } while (false)
+
+// Same as LOG_AT, for anything that can be streamed instead of a format string.
+#define LOG_VALUE(logger, level, value)                \
+    do                                                 \
+    {                                                  \
+        if constexpr ((level) >= LOG_COMPILE_LEVEL)    \
+        {                                              \
+            if ((logger).is_active())                  \
+                (logger)(value);                       \
+        }                                              \
+    } while (false)
+
+#ifndef LOG_LIMITED_INTERVAL_MS
+#define LOG_LIMITED_INTERVAL_MS 1000
+#endif
+
+// LOG_AT that writes at most once per LOG_LIMITED_INTERVAL_MS from this call site, with a "repeated N times" summary.
+#define LOG_AT_LIMITED(logger, level, ...)                                                                   \
+    do                                                                                                       \
+    {                                                                                                        \
+        if constexpr ((level) >= LOG_COMPILE_LEVEL)                                                          \
+        {                                                                                                    \
+            static Log::CallSiteLimiter _log_limiter;                                                        \
+            if (const auto _log_decision = _log_limiter.hit(LOG_LIMITED_INTERVAL_MS * 1'000'000LL);          \
+                _log_decision.log && (logger).is_active())                                                   \
+                (logger)(Log::format(__VA_ARGS__) + Log::repeated_suffix(_log_decision.repeated));           \
+        }                                                                                                    \
+    } while (false)
+
+#define LOG_INFO(...) LOG_AT(Log::info, Log::Level::Info, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(Log::debug, Log::Level::Debug, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(Log::warn, Log::Level::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(Log::error, Log::Level::Error, __VA_ARGS__)
+
+// Records per logging thread.
+#ifndef LOG_ASYNC_DEFAULT_CAPACITY
+#define LOG_ASYNC_DEFAULT_CAPACITY 1024
+#endif
+
 namespace Log
 {
     enum class Color
@@ -38,9 +106,27 @@ namespace Log
         Datetime,
         Enabled,
         SuccesIfDisabled,
-        SuccessIfHidden
+        SuccessIfHidden,
+        ThreadTag,
+        Deduplicate
+    };
+
+    // What an async logger does when the ring buffer is full.
+    enum class Overflow
+    {
+        Drop,
+        Block
     };
 
+    // Levels of the default loggers, usable in constant expressions.
+    namespace Level
+    {
+        constexpr size_t Info = 10;
+        constexpr size_t Debug = 20;
+        constexpr size_t Warn = 30;
+        constexpr size_t Error = 40;
+    }
+
     static size_t GLOBAL_LOG_LEVEL{0};
 
     template <size_t BuffSize = 512>
@@ -54,6 +140,796 @@ namespace Log
         return std::string{buff};
     }
 
+    static constexpr inline auto color_code(Color color) -> const char *
+    {
+        switch (color)
+        {
+        case Color::Black:
+            return "\u001b[30m";
+        case Color::Red:
+            return "\u001b[31m";
+        case Color::Green:
+            return "\u001b[32m";
+        case Color::Yellow:
+            return "\u001b[33m";
+        case Color::Blue:
+            return "\u001b[34m";
+        case Color::Magenta:
+            return "\u001b[35m";
+        case Color::Cyan:
+            return "\u001b[36m";
+        case Color::White:
+            return "\u001b[37m";
+        default:
+            return "\u001b[0m";
+        }
+    }
+
+    // A fully formatted line (datetime, tag, message and newline), built once and handed to every sink of a logger.
+    struct Record
+    {
+        std::string_view line;
+        Color color;
+        bool ansi;
+    };
+
+    // Destination of log records. Calls are serialized per sink, so one sink can be shared by several loggers.
+    class AbstractSink
+    {
+    public:
+        virtual ~AbstractSink(){};
+
+        inline auto write(const Record &record) -> void
+        {
+            std::lock_guard lock(mutex);
+            write_record(record);
+        }
+
+        inline auto flush() -> void
+        {
+            std::lock_guard lock(mutex);
+            flush_records();
+        }
+
+        // Writes out buffered records whose flush interval has passed. Returns when to call again,
+        // time_point::max() if nothing is buffered.
+        inline auto maybe_flush(std::chrono::steady_clock::time_point now) -> std::chrono::steady_clock::time_point
+        {
+            std::lock_guard lock(mutex);
+            return flush_if_due(now);
+        }
+
+        // Interactive sinks are flushed after every record written on the calling thread.
+        virtual inline auto interactive() const -> bool { return false; }
+        // Timed sinks have maybe_flush called by the background writer, even when no more records arrive.
+        virtual inline auto timed() const -> bool { return false; }
+        virtual inline auto good() const -> bool { return true; }
+
+    protected:
+        virtual inline auto write_record(const Record &record) -> void = 0;
+        virtual inline auto flush_records() -> void = 0;
+        virtual inline auto flush_if_due(std::chrono::steady_clock::time_point) -> std::chrono::steady_clock::time_point
+        {
+            return std::chrono::steady_clock::time_point::max();
+        }
+
+    private:
+        std::mutex mutex;
+    };
+
+    class ConsoleSink : public AbstractSink
+    {
+    public:
+        ConsoleSink(std::ostream &stream = std::clog) : stream(&stream) {}
+
+        virtual inline auto interactive() const -> bool override { return true; }
+        virtual inline auto good() const -> bool override { return stream->good(); }
+
+    protected:
+        virtual inline auto write_record(const Record &record) -> void override
+        {
+            if (record.ansi)
+                *stream << color_code(record.color) << record.line << color_code(Color::Default);
+            else
+                *stream << record.line;
+        }
+
+        virtual inline auto flush_records() -> void override
+        {
+            stream->flush();
+        }
+
+    private:
+        std::ostream *stream;
+    };
+
+    // Appends to a file through a large in-memory buffer. The buffer is handed to the OS when it fills up,
+    // when flush_interval has passed since the last hand-off (checked by the background writer once the sink is
+    // added to a Logger), or on flush(). Nothing here calls fsync.
+    class FileSink : public AbstractSink
+    {
+    public:
+        FileSink(const std::string &path, size_t buffer_size = 1 << 16, std::chrono::milliseconds flush_interval = std::chrono::seconds(1))
+            : path(path), buffer_size(buffer_size), flush_interval(flush_interval)
+        {
+            buffer.reserve(buffer_size);
+            open();
+        }
+
+        virtual ~FileSink()
+        {
+            if (file)
+            {
+                write_out();
+                std::fclose(file);
+            }
+        }
+
+        virtual inline auto timed() const -> bool override { return true; }
+        virtual inline auto good() const -> bool override { return file != nullptr; }
+
+    protected:
+        virtual inline auto write_record(const Record &record) -> void override
+        {
+            buffer.append(record.line);
+
+            if (buffer.size() >= buffer_size || std::chrono::steady_clock::now() - last_write_out >= flush_interval)
+                write_out();
+        }
+
+        virtual inline auto flush_records() -> void override
+        {
+            write_out();
+            if (file)
+                std::fflush(file);
+        }
+
+        virtual inline auto flush_if_due(std::chrono::steady_clock::time_point now) -> std::chrono::steady_clock::time_point override
+        {
+            if (buffer.empty())
+                return std::chrono::steady_clock::time_point::max();
+
+            if (now - last_write_out < flush_interval)
+                return last_write_out + flush_interval;
+
+            flush_records();
+            return std::chrono::steady_clock::time_point::max();
+        }
+
+        inline auto open() -> void
+        {
+            file = std::fopen(path.c_str(), "ab");
+            if (not file)
+            {
+                std::clog << "[LOG] Could not open log file " << path << '\n';
+                return;
+            }
+
+            std::fseek(file, 0, SEEK_END);
+            file_size = static_cast<size_t>(std::ftell(file));
+            opened = std::chrono::steady_clock::now();
+        }
+
+        inline auto write_out() -> void
+        {
+            if (file && not buffer.empty())
+            {
+                std::fwrite(buffer.data(), 1, buffer.size(), file);
+                file_size += buffer.size();
+            }
+
+            buffer.clear();
+            last_write_out = std::chrono::steady_clock::now();
+        }
+
+        // Bytes in the file plus bytes still buffered.
+        inline auto size() const -> size_t
+        {
+            return file_size + buffer.size();
+        }
+
+        std::string path;
+        std::FILE *file{nullptr};
+        size_t file_size{0};
+        std::chrono::steady_clock::time_point opened, last_write_out{std::chrono::steady_clock::now()};
+
+    private:
+        std::string buffer;
+        size_t buffer_size;
+        std::chrono::milliseconds flush_interval;
+    };
+
+    // A FileSink that moves "path" to "path.1" (and "path.1" to "path.2", ...) once the file grows past max_bytes
+    // or becomes older than max_age. Zero disables either limit. At most max_files old files are kept.
+    class RotatingFileSink : public FileSink
+    {
+    public:
+        RotatingFileSink(const std::string &path, size_t max_bytes, size_t max_files, std::chrono::seconds max_age = std::chrono::seconds(0), size_t buffer_size = 1 << 16)
+            : FileSink(path, buffer_size), max_bytes(max_bytes), max_files(max_files), max_age(max_age)
+        {
+        }
+
+    protected:
+        virtual inline auto write_record(const Record &record) -> void override
+        {
+            const bool too_big = max_bytes && size() + record.line.size() > max_bytes && size() > 0;
+            const bool too_old = max_age.count() && std::chrono::steady_clock::now() - opened >= max_age;
+
+            if (too_big || too_old)
+                rotate();
+
+            FileSink::write_record(record);
+        }
+
+    private:
+        inline auto rotate() -> void
+        {
+            if (file)
+            {
+                write_out();
+                std::fclose(file);
+                file = nullptr;
+            }
+
+            if (max_files == 0)
+            {
+                std::remove(path.c_str());
+            }
+            else
+            {
+                std::remove((path + '.' + std::to_string(max_files)).c_str());
+                for (size_t i = max_files - 1; i > 0; i--)
+                    std::rename((path + '.' + std::to_string(i)).c_str(), (path + '.' + std::to_string(i + 1)).c_str());
+                std::rename(path.c_str(), (path + ".1").c_str());
+            }
+
+            file_size = 0;
+            open();
+        }
+
+        size_t max_bytes, max_files;
+        std::chrono::seconds max_age;
+    };
+
+    namespace _impl
+    {
+        // Shared by every logger that was not given sinks explicitly.
+        inline auto default_sink() -> const std::shared_ptr<AbstractSink> &
+        {
+            static std::shared_ptr<AbstractSink> sink = std::make_shared<ConsoleSink>(std::clog);
+            return sink;
+        }
+    }
+
+    namespace _impl
+    {
+        inline auto steady_ns() -> int64_t
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // Rate limit (a token bucket, in its GCRA form: a single atomic "theoretical arrival time")
+        // and deduplication state of one logger, shared by its copies.
+        struct Throttle
+        {
+            std::atomic<int64_t> interval_ns{0}, tolerance_ns{0}, arrival{0};
+            std::atomic<size_t> suppressed{0};
+            std::atomic<size_t> last_hash{0}, repeats{0};
+
+            inline auto limited() const -> bool
+            {
+                return interval_ns.load(std::memory_order_relaxed) != 0;
+            }
+
+            // Only reads the bucket, but counts the message as suppressed when it would be rejected.
+            inline auto would_admit() -> bool
+            {
+                if (not limited())
+                    return true;
+
+                const auto now = steady_ns();
+                if (std::max(arrival.load(std::memory_order_relaxed), now) - now > tolerance_ns.load(std::memory_order_relaxed))
+                {
+                    suppressed.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                return true;
+            }
+
+            inline auto try_take() -> bool
+            {
+                const auto interval = interval_ns.load(std::memory_order_relaxed);
+                if (interval == 0)
+                    return true;
+
+                const auto now = steady_ns();
+                auto current = arrival.load(std::memory_order_relaxed);
+                int64_t next;
+                do
+                {
+                    const auto base = std::max(current, now);
+                    if (base - now > tolerance_ns.load(std::memory_order_relaxed))
+                    {
+                        suppressed.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
+                    next = base + interval;
+                } while (not arrival.compare_exchange_weak(current, next, std::memory_order_relaxed));
+
+                return true;
+            }
+        };
+    }
+
+    // Per call site suppression, see SOFT_ASSERT and LOG_AT_LIMITED. The first hit is let through, then at most one
+    // per interval, reporting how many were swallowed in between. Past the first few suppressed hits, a rejected hit
+    // only increments a counter (the clock is read on every 64th).
+    class CallSiteLimiter
+    {
+    public:
+        struct Decision
+        {
+            bool log;
+            size_t repeated;
+        };
+
+        inline auto hit(int64_t interval_ns) -> Decision
+        {
+            const size_t previous = suppressed.fetch_add(1, std::memory_order_relaxed);
+            if (previous >= 64 && (previous & 63) != 0)
+                return {false, 0};
+
+            const auto now = _impl::steady_ns();
+            auto next = next_report.load(std::memory_order_relaxed);
+            if (now < next || not next_report.compare_exchange_strong(next, now + interval_ns, std::memory_order_relaxed))
+                return {false, 0};
+
+            return {true, suppressed.exchange(0, std::memory_order_relaxed) - 1};
+        }
+
+    private:
+        std::atomic<size_t> suppressed{0};
+        std::atomic<int64_t> next_report{0};
+    };
+
+    inline auto repeated_suffix(size_t repeated) -> std::string
+    {
+        return repeated ? format(" (repeated %zu times since last report)", repeated) : std::string();
+    }
+
+    class Logger;
+
+    namespace _impl
+    {
+        // Small sequential id of the calling thread, in the order threads first asked for it.
+        inline auto thread_index() -> uint32_t
+        {
+            static std::atomic<uint32_t> next{0};
+            thread_local const uint32_t index = next.fetch_add(1, std::memory_order_relaxed);
+            return index;
+        }
+
+        inline auto now_ns() -> int64_t
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        // A message copied out of the producing thread, rendered later by the AsyncWriter's thread.
+        // Longer messages are cut to TEXT_CAPACITY bytes, ending in TRUNCATION_MARKER.
+        struct AsyncRecord
+        {
+            static constexpr size_t TEXT_CAPACITY = 480;
+            static constexpr std::string_view TRUNCATION_MARKER = "...";
+
+            const Logger *logger;
+            int64_t timestamp;
+            uint32_t thread;
+            size_t length;
+            char text[TEXT_CAPACITY];
+        };
+
+        // Bounded single-producer single-consumer ring owned by one logging thread, so producers never contend.
+        class ThreadBuffer
+        {
+        public:
+            ThreadBuffer(size_t capacity) : records(capacity), mask(capacity - 1)
+            {
+            }
+
+            inline auto try_push(const Logger &logger, int64_t timestamp, std::string_view text) -> bool
+            {
+                const size_t pos = head.load(std::memory_order_relaxed);
+                if (pos - tail.load(std::memory_order_acquire) > mask)
+                    return false;
+
+                auto &record = records[pos & mask];
+                record.logger = &logger;
+                record.timestamp = timestamp;
+                record.thread = thread_index();
+                if (text.size() <= AsyncRecord::TEXT_CAPACITY)
+                {
+                    record.length = text.size();
+                    std::memcpy(record.text, text.data(), record.length);
+                }
+                else
+                {
+                    constexpr size_t kept = AsyncRecord::TEXT_CAPACITY - AsyncRecord::TRUNCATION_MARKER.size();
+                    std::memcpy(record.text, text.data(), kept);
+                    std::memcpy(record.text + kept, AsyncRecord::TRUNCATION_MARKER.data(), AsyncRecord::TRUNCATION_MARKER.size());
+                    record.length = AsyncRecord::TEXT_CAPACITY;
+                }
+
+                head.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+
+            inline auto available() const -> size_t
+            {
+                return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+            }
+
+            inline auto peek(size_t offset) -> AsyncRecord &
+            {
+                return records[(tail.load(std::memory_order_relaxed) + offset) & mask];
+            }
+
+            inline auto release(size_t count) -> void
+            {
+                tail.store(tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+            }
+
+            // Whether everything pushed before the given head position has been consumed.
+            inline auto consumed(size_t position) const -> bool
+            {
+                return tail.load(std::memory_order_acquire) >= position;
+            }
+
+            inline auto position() const -> size_t
+            {
+                return head.load(std::memory_order_acquire);
+            }
+
+            // Set when the owning thread exits, the writer drops the buffer once it is drained.
+            std::atomic<bool> orphaned{false};
+
+        private:
+            std::vector<AsyncRecord> records;
+            size_t mask;
+
+            alignas(64) std::atomic<size_t> head{0};
+            alignas(64) std::atomic<size_t> tail{0};
+        };
+
+        // Every logging thread appends to its own ThreadBuffer. A single background thread drains all of them,
+        // merges each drained batch by timestamp, does the datetime formatting, coloring and writing,
+        // and flushes interactive sinks once per batch. It also wakes up for the flush interval of timed sinks,
+        // whether their loggers are async or not.
+        class AsyncWriter
+        {
+        public:
+            // Set for as long as the writer is alive, so shutdown paths do not resurrect it.
+            static inline std::atomic<bool> instantiated{false};
+
+            AsyncWriter()
+            {
+                buffer_capacity = round_capacity(LOG_ASYNC_DEFAULT_CAPACITY);
+                start();
+                instantiated = true;
+            }
+
+            AsyncWriter(const AsyncWriter &) = delete;
+            AsyncWriter(AsyncWriter &&) = delete;
+            inline auto operator=(const AsyncWriter &) = delete;
+            inline auto operator=(AsyncWriter &&) = delete;
+
+            ~AsyncWriter()
+            {
+                instantiated = false;
+                stop();
+            }
+
+            // Capacity is per thread and rounded up to a power of two. Pending records are written first.
+            // Meant to be called before other threads start logging.
+            inline auto configure(size_t capacity, Overflow policy) -> void
+            {
+                stop();
+
+                {
+                    std::lock_guard lock(buffers_mutex);
+                    buffers.clear();
+                    buffers_version++;
+                }
+
+                buffer_capacity = round_capacity(capacity);
+                overflow = policy;
+                generation++;
+                start();
+            }
+
+            inline auto push(const Logger &logger, std::string_view text) -> bool
+            {
+                auto &buffer = thread_buffer();
+                const auto timestamp = now_ns();
+
+                while (not buffer.try_push(logger, timestamp, text))
+                {
+                    if (overflow == Overflow::Drop)
+                    {
+                        dropped.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
+
+                    wake();
+                    std::this_thread::yield();
+                }
+
+                if (text.size() > AsyncRecord::TEXT_CAPACITY)
+                    truncated.fetch_add(1, std::memory_order_relaxed);
+
+                // Pairs with the fence in consume(): either the writer sees the record or we see it sleeping.
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (sleeping.load(std::memory_order_relaxed))
+                    wake();
+
+                return true;
+            }
+
+            // Blocks until every record pushed (by any thread) before the call has been written.
+            inline auto flush() -> void
+            {
+                std::vector<std::pair<std::shared_ptr<ThreadBuffer>, size_t>> targets;
+                {
+                    std::lock_guard lock(buffers_mutex);
+                    for (const auto &buffer : buffers)
+                        targets.emplace_back(buffer, buffer->position());
+                }
+
+                wake();
+                for (const auto &[buffer, position] : targets)
+                {
+                    while (not buffer->consumed(position))
+                        std::this_thread::yield();
+                }
+            }
+
+            inline auto dropped_count() const -> size_t
+            {
+                return dropped.load(std::memory_order_relaxed);
+            }
+
+            inline auto truncated_count() const -> size_t
+            {
+                return truncated.load(std::memory_order_relaxed);
+            }
+
+            // Has the writer call the sink's maybe_flush for as long as the sink is alive.
+            inline auto watch(const std::shared_ptr<AbstractSink> &sink) -> void
+            {
+                {
+                    std::lock_guard lock(timed_mutex);
+                    for (const auto &watched : timed_sinks)
+                    {
+                        if (watched.lock() == sink)
+                            return;
+                    }
+                    timed_sinks.push_back(sink);
+                }
+                wake();
+            }
+
+        private:
+            // Releases the thread's buffer to the writer when the thread exits.
+            struct Handle
+            {
+                std::shared_ptr<ThreadBuffer> buffer;
+                size_t generation{0};
+
+                ~Handle()
+                {
+                    if (buffer)
+                        buffer->orphaned = true;
+                }
+            };
+
+            inline auto thread_buffer() -> ThreadBuffer &
+            {
+                thread_local Handle handle;
+
+                if (not handle.buffer || handle.generation != generation)
+                {
+                    if (handle.buffer)
+                        handle.buffer->orphaned = true;
+
+                    handle.buffer = std::make_shared<ThreadBuffer>(buffer_capacity);
+                    handle.generation = generation;
+
+                    std::lock_guard lock(buffers_mutex);
+                    buffers.push_back(handle.buffer);
+                    buffers_version++;
+                }
+
+                return *handle.buffer;
+            }
+
+            static inline auto round_capacity(size_t capacity) -> size_t
+            {
+                size_t size{1};
+                while (size < capacity)
+                    size <<= 1;
+                return size;
+            }
+
+            inline auto start() -> void
+            {
+                running = true;
+                thread = std::thread(&AsyncWriter::consume, this);
+            }
+
+            inline auto stop() -> void
+            {
+                if (not thread.joinable())
+                    return;
+
+                running = false;
+                wake();
+                thread.join();
+            }
+
+            inline auto wake() -> void
+            {
+                {
+                    std::lock_guard lock(wake_mutex);
+                    wakeups.fetch_add(1, std::memory_order_release);
+                }
+                wake_signal.notify_one();
+            }
+
+            // Returns the earliest time a timed sink wants to be checked again.
+            inline auto flush_timed_sinks() -> std::chrono::steady_clock::time_point
+            {
+                const auto now = std::chrono::steady_clock::now();
+                auto next = std::chrono::steady_clock::time_point::max();
+
+                std::lock_guard lock(timed_mutex);
+                std::erase_if(timed_sinks, [&](const std::weak_ptr<AbstractSink> &watched)
+                              {
+                    const auto sink = watched.lock();
+                    if (sink)
+                        next = std::min(next, sink->maybe_flush(now));
+                    return not sink; });
+                return next;
+            }
+
+            inline auto consume() -> void
+            {
+                std::vector<std::shared_ptr<ThreadBuffer>> local;
+                std::vector<size_t> counts;
+                std::vector<AsyncRecord *> batch;
+                std::vector<AbstractSink *> touched;
+                size_t local_version{static_cast<size_t>(-1)}, reported_drops{0};
+
+                while (true)
+                {
+                    const auto seen = wakeups.load(std::memory_order_acquire);
+
+                    if (local_version != buffers_version.load(std::memory_order_acquire))
+                    {
+                        std::lock_guard lock(buffers_mutex);
+                        local = buffers;
+                        local_version = buffers_version;
+                    }
+
+                    batch.clear();
+                    counts.resize(local.size());
+                    for (size_t i = 0; i < local.size(); i++)
+                    {
+                        counts[i] = local[i]->available();
+                        for (size_t j = 0; j < counts[i]; j++)
+                            batch.push_back(&local[i]->peek(j));
+                    }
+
+                    // Each buffer is already in order, merge them into one timeline.
+                    std::stable_sort(batch.begin(), batch.end(), [](const AsyncRecord *a, const AsyncRecord *b)
+                                     { return a->timestamp < b->timestamp; });
+
+                    for (auto record : batch)
+                        write(*record, touched);
+
+                    if (const auto drops = dropped_count(); drops != reported_drops)
+                    {
+                        report_drops(drops - reported_drops);
+                        reported_drops = drops;
+                    }
+
+                    // Only interactive sinks are flushed per batch, timed ones keep buffering until their interval.
+                    for (auto sink : touched)
+                        sink->flush();
+                    touched.clear();
+
+                    const auto next_flush = flush_timed_sinks();
+
+                    bool any_orphaned{false};
+                    for (size_t i = 0; i < local.size(); i++)
+                    {
+                        local[i]->release(counts[i]);
+                        any_orphaned = any_orphaned || (local[i]->orphaned && local[i]->available() == 0);
+                    }
+
+                    if (any_orphaned)
+                    {
+                        std::lock_guard lock(buffers_mutex);
+                        std::erase_if(buffers, [](const auto &buffer)
+                                      { return buffer->orphaned && buffer->available() == 0; });
+                        buffers_version++;
+                    }
+
+                    if (batch.empty())
+                    {
+                        if (not running)
+                            break;
+
+                        sleeping.store(true, std::memory_order_relaxed);
+                        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                        bool pending{false};
+                        for (const auto &buffer : local)
+                            pending = pending || buffer->available();
+
+                        if (not pending && local_version == buffers_version.load(std::memory_order_acquire))
+                        {
+                            const auto woken = [&]()
+                            { return wakeups.load(std::memory_order_acquire) != seen; };
+
+                            std::unique_lock lock(wake_mutex);
+                            if (next_flush == std::chrono::steady_clock::time_point::max())
+                                wake_signal.wait(lock, woken);
+                            else
+                                wake_signal.wait_until(lock, next_flush, woken);
+                        }
+
+                        sleeping.store(false, std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            // Defined after Logger.
+            inline auto write(const AsyncRecord &record, std::vector<AbstractSink *> &touched) -> void;
+            // Defined after the default loggers, goes through Log::warn like any other message.
+            inline auto report_drops(size_t count) -> void;
+
+            // Records mostly share the second they were logged in, so the formatted datetime is reused.
+            std::time_t stamp_time{-1};
+            std::string stamp_format, stamp, line;
+
+            std::mutex buffers_mutex;
+            std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+            std::atomic<size_t> buffers_version{0};
+
+            size_t buffer_capacity;
+            std::atomic<size_t> generation{0};
+            Overflow overflow{Overflow::Block};
+
+            alignas(64) std::atomic<size_t> dropped{0};
+            std::atomic<size_t> truncated{0};
+            alignas(64) std::atomic<uint32_t> wakeups{0};
+            alignas(64) std::atomic<bool> sleeping{false};
+            std::mutex wake_mutex;
+            std::condition_variable wake_signal;
+
+            std::mutex timed_mutex;
+            std::vector<std::weak_ptr<AbstractSink>> timed_sinks;
+            std::atomic<bool> running{false};
+
+            std::thread thread;
+        };
+
+        inline auto async_writer() -> AsyncWriter &
+        {
+            static AsyncWriter writer;
+            return writer;
+        }
+    }
+
     class Logger
     {
 
@@ -64,8 +940,23 @@ namespace Log
         {
         }
 
+        ~Logger()
+        {
+            // Records in flight point back to this logger.
+            if (async && _impl::AsyncWriter::instantiated)
+                _impl::async_writer().flush();
+        }
+
         operator size_t() { return log_level; }
 
+        // Whether a message would currently be written, cheap enough to guard formatting with.
+        // With a rate limit set, an exhausted bucket also makes the logger inactive.
+        inline auto is_active() const -> bool
+        {
+            return get_flag(Flag::Enabled) && log_level >= GLOBAL_LOG_LEVEL && throttle->would_admit();
+        }
+
+        // In async mode the return value tells whether the message was queued, not whether it was written.
         template <typename T>
         inline auto operator()(const T &e) const -> bool
         {
@@ -75,24 +966,17 @@ namespace Log
             if (log_level < GLOBAL_LOG_LEVEL)
                 return get_flag(Flag::SuccessIfHidden);
 
-            if (get_flag(Flag::Ansi))
-                *stream << color_code(color);
-
-            if (get_flag(Flag::Datetime))
+            if constexpr (std::is_convertible_v<const T &, std::string_view>)
             {
-                auto time = std::time(nullptr);
-                *stream << std::put_time(std::localtime(&time), datetime_format.c_str()) << ' ';
+                return emit(e);
+            }
+            else
+            {
+                thread_local std::ostringstream text;
+                text.str("");
+                text << e;
+                return emit(text.view());
             }
-
-            if (get_flag(Flag::Tag))
-                *stream << "[" << tag << "] ";
-
-            *stream << e << std::endl;
-
-            if (get_flag(Flag::Ansi))
-                *stream << color_code(Color::Default);
-
-            return stream->good();
         }
         inline auto set_flag(Flag flag, bool value) -> Logger &
         {
@@ -114,63 +998,262 @@ namespace Log
             this->datetime_format = format;
             return *this;
         }
+        // Replaces every sink with a single ConsoleSink writing to the stream.
         inline auto set_stream(std::ostream &stream) -> Logger &
         {
-            this->stream = &stream;
+            return clear_sinks().add_sink(std::make_shared<ConsoleSink>(stream));
+        }
+        // Every record is formatted once and then written to all sinks of the logger.
+        inline auto add_sink(const std::shared_ptr<AbstractSink> &sink) -> Logger &
+        {
+            flush();
+            sinks.push_back(sink);
+            if (sink->timed())
+                _impl::async_writer().watch(sink);
             return *this;
         }
+        inline auto clear_sinks() -> Logger &
+        {
+            flush();
+            sinks.clear();
+            return *this;
+        }
+        inline auto get_sinks() const -> const std::vector<std::shared_ptr<AbstractSink>> &
+        {
+            return sinks;
+        }
         inline auto set_color(Color color) -> Logger &
         {
             this->color = color;
             return *this;
         }
+        // Let at most per_second messages through on average, with bursts of up to burst messages.
+        // The number of rejected messages is reported with the next one let through. Zero disables the limit.
+        inline auto set_rate_limit(double per_second, size_t burst = 1) -> Logger &
+        {
+            const auto interval = per_second > 0 ? static_cast<int64_t>(1e9 / per_second) : 0;
+            throttle->interval_ns = interval;
+            throttle->tolerance_ns = interval * static_cast<int64_t>(std::max<size_t>(burst, 1) - 1);
+            throttle->arrival = 0;
+            return *this;
+        }
+        // Hand messages to the background writer instead of writing them on the calling thread. Async messages are
+        // limited to AsyncRecord::TEXT_CAPACITY (480) bytes, longer ones are cut and counted (see truncated_count).
+        inline auto set_async(bool async) -> Logger &
+        {
+            if (this->async && not async)
+                _impl::async_writer().flush();
+
+            this->async = async;
+            return *this;
+        }
+
+        // Writes out queued records (in async mode) and flushes every sink.
+        inline auto flush() const -> void
+        {
+            if (async && _impl::AsyncWriter::instantiated)
+                _impl::async_writer().flush();
+
+            for (const auto &sink : sinks)
+                sink->flush();
+        }
 
     private:
+        inline auto emit(std::string_view message) const -> bool
+        {
+            if (get_flag(Flag::Deduplicate))
+            {
+                const auto hash = std::hash<std::string_view>{}(message);
+                if (throttle->last_hash.exchange(hash, std::memory_order_relaxed) == hash)
+                {
+                    throttle->repeats.fetch_add(1, std::memory_order_relaxed);
+                    return get_flag(Flag::SuccessIfHidden);
+                }
+
+                if (const auto repeats = throttle->repeats.exchange(0, std::memory_order_relaxed))
+                    write(format("Previous message repeated %zu times", repeats));
+            }
+
+            if (throttle->limited())
+            {
+                if (not throttle->try_take())
+                    return get_flag(Flag::SuccessIfHidden);
+
+                if (const auto suppressed = throttle->suppressed.exchange(0, std::memory_order_relaxed))
+                    write(format("Rate limit suppressed %zu messages", suppressed));
+            }
+
+            return write(message);
+        }
+
+        inline auto write(std::string_view message) const -> bool
+        {
+            if (async)
+                return _impl::async_writer().push(*this, message);
+
+            thread_local std::string line;
+            if (get_flag(Flag::Datetime))
+                format_line(line, datetime(std::time(nullptr)), _impl::thread_index(), message);
+            else
+                format_line(line, std::string_view(), _impl::thread_index(), message);
+
+            return dispatch(line, true);
+        }
+
+        inline auto datetime(std::time_t time) const -> std::string
+        {
+            char buff[128];
+            const auto length = std::strftime(buff, sizeof(buff), datetime_format.c_str(), std::localtime(&time));
+            return std::string(buff, length);
+        }
+
+        template <typename T>
+        inline auto format_line(std::string &line, std::string_view stamp, uint32_t thread, const T &e) const -> void
+        {
+            line.clear();
+
+            if (get_flag(Flag::Datetime))
+            {
+                line += stamp;
+                line += ' ';
+            }
+
+            if (get_flag(Flag::ThreadTag))
+            {
+                line += "[T";
+                line += std::to_string(thread);
+                line += "] ";
+            }
+
+            if (get_flag(Flag::Tag))
+            {
+                line += '[';
+                line += tag;
+                line += "] ";
+            }
+
+            if constexpr (std::is_convertible_v<const T &, std::string_view>)
+            {
+                line += std::string_view(e);
+            }
+            else
+            {
+                thread_local std::ostringstream text;
+                text.str("");
+                text << e;
+                line += text.view();
+            }
+
+            line += '\n';
+        }
+
+        // Interactive sinks are flushed right away unless the caller batches flushes itself.
+        inline auto dispatch(std::string_view line, bool flush_interactive) const -> bool
+        {
+            const Record record{line, color, get_flag(Flag::Ansi)};
+            bool good{true};
+
+            for (const auto &sink : sinks)
+            {
+                sink->write(record);
+                if (flush_interactive && sink->interactive())
+                    sink->flush();
+                good = good && sink->good();
+            }
+
+            return good;
+        }
+
         std::string tag{"LOG"};
         std::string datetime_format{DEFAULT_DATETIME_FORMAT};
 
         Color color{Color::Default};
-        std::ostream *stream{&std::clog};
+        std::vector<std::shared_ptr<AbstractSink>> sinks{_impl::default_sink()};
 
-        std::bitset<6> flags{0xffffffffUL};
+        // Everything but ThreadTag and Deduplicate is on by default.
+        std::bitset<8> flags{0x3fUL};
 
         size_t log_level{0};
+        bool async{false};
+
+        std::shared_ptr<_impl::Throttle> throttle{std::make_shared<_impl::Throttle>()};
+
+        friend class _impl::AsyncWriter;
 
         inline auto get_flag(Flag flag) const -> bool
         {
             return flags[static_cast<size_t>(flag)];
         }
+    };
 
-        static constexpr inline auto color_code(Color color) -> const char *
+    inline auto _impl::AsyncWriter::write(const AsyncRecord &record, std::vector<AbstractSink *> &touched) -> void
+    {
+        const auto &logger = *record.logger;
+
+        const std::time_t time = record.timestamp / 1'000'000'000;
+        if (logger.get_flag(Flag::Datetime) && (time != stamp_time || logger.datetime_format != stamp_format))
         {
-            switch (color)
-            {
-            case Color::Black:
-                return "\u001b[30m";
-            case Color::Red:
-                return "\u001b[31m";
-            case Color::Green:
-                return "\u001b[32m";
-            case Color::Yellow:
-                return "\u001b[33m";
-            case Color::Blue:
-                return "\u001b[34m";
-            case Color::Magenta:
-                return "\u001b[35m";
-            case Color::Cyan:
-                return "\u001b[36m";
-            case Color::White:
-                return "\u001b[37m";
-            default:
-                return "\u001b[0m";
-            }
+            stamp = logger.datetime(time);
+            stamp_time = time;
+            stamp_format = logger.datetime_format;
         }
-    };
 
-    static Logger info("INFO", Color::Default, 10);
-    static Logger debug("DEBUG", Color::Green, 20);
-    static Logger warn("WARNING", Color::Yellow, 30);
-    static Logger error("ERROR", Color::Red, 40);
+        logger.format_line(line, stamp, record.thread, std::string_view(record.text, record.length));
+        logger.dispatch(line, false);
+
+        for (const auto &sink : logger.sinks)
+        {
+            if (sink->interactive() && std::find(touched.begin(), touched.end(), sink.get()) == touched.end())
+                touched.push_back(sink.get());
+        }
+    }
+
+    static Logger info("INFO", Color::Default, Level::Info);
+    static Logger debug("DEBUG", Color::Green, Level::Debug);
+    static Logger warn("WARNING", Color::Yellow, Level::Warn);
+    static Logger error("ERROR", Color::Red, Level::Error);
+
+    // Switch the default loggers between writing on the calling thread and writing from the background thread.
+    inline auto set_async(bool async) -> void
+    {
+        for (auto logger : {&info, &debug, &warn, &error})
+            logger->set_async(async);
+    }
+
+    inline auto configure_async(size_t capacity, Overflow policy) -> void
+    {
+        _impl::async_writer().configure(capacity, policy);
+    }
+
+    // Messages lost to a full per-thread buffer under Overflow::Drop.
+    inline auto dropped_count() -> size_t
+    {
+        return _impl::async_writer().dropped_count();
+    }
+
+    // Async messages cut to the record size, see Logger::set_async.
+    inline auto truncated_count() -> size_t
+    {
+        return _impl::async_writer().truncated_count();
+    }
+
+    inline auto _impl::AsyncWriter::report_drops(size_t count) -> void
+    {
+        warn(format("Async buffer full, dropped %zu message(s)", count));
+    }
+
+    // Wait until every message queued so far has been written, then flush the sinks of the default loggers.
+    inline auto flush() -> void
+    {
+        if (_impl::AsyncWriter::instantiated)
+            _impl::async_writer().flush();
+
+        for (auto logger : {&info, &debug, &warn, &error})
+        {
+            for (const auto &sink : logger->get_sinks())
+                sink->flush();
+        }
+    }
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,395 @@
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+#include "Error.hpp"
+
+/*
+Allocation tracking. With ALLOC_TRACKING defined this header replaces the global operator new/delete, so it must be
+included by exactly one translation unit (like the rest of this header-only code base). It counts allocations and
+bytes in total, per frame (Memory::next_frame, called by Application::run) and per ALLOC_SCOPE.
+
+Frames can be marked as steady-state, where the game loop is expected not to allocate at all: every allocation is then
+reported to stderr with its backtrace, without allocating itself. Link with -rdynamic to get symbol names.
+Without ALLOC_TRACKING every macro expands to nothing; Memory::get_peak_rss works either way.
+*/
+
+#ifdef ALLOC_TRACKING
+
+#include <execinfo.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <mutex>
+#include <new>
+
+#define ALLOC_CONCAT_IMPL(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_IMPL(a, b)
+
+#define ALLOC_SCOPE(name) const Memory::Scope ALLOC_CONCAT(_alloc_scope_, __LINE__)(name)
+#define ALLOC_NEXT_FRAME() Memory::next_frame()
+#define ALLOC_EXEMPT() const Memory::Exempt ALLOC_CONCAT(_alloc_exempt_, __LINE__)
+
+namespace Memory
+{
+    struct Counters
+    {
+        size_t allocations{0}, deallocations{0}, bytes{0};
+
+        inline auto operator-(const Counters &other) const -> Counters
+        {
+            return {allocations - other.allocations, deallocations - other.deallocations, bytes - other.bytes};
+        }
+    };
+
+    struct ScopeStats
+    {
+        const char *name;
+        size_t calls, allocations, bytes;
+    };
+
+    namespace _impl
+    {
+        struct Totals
+        {
+            std::atomic<size_t> allocations{0}, deallocations{0}, bytes{0};
+
+            inline auto load() const -> Counters
+            {
+                return {allocations.load(std::memory_order_relaxed), deallocations.load(std::memory_order_relaxed),
+                        bytes.load(std::memory_order_relaxed)};
+            }
+        };
+
+        // Every member is constant-initialized, so all of this is usable before main and from any operator new.
+        inline Totals totals;
+        inline thread_local Counters thread_counters;
+
+        inline std::atomic<bool> steady{false};
+        inline std::atomic<size_t> violations{0};
+        inline thread_local bool reporting{false};
+        inline thread_local size_t exempt{0};
+
+        inline Counters frame_begin, last_frame;
+        inline size_t frames{0}, steady_after{0};
+
+        constexpr size_t MAX_SCOPES = 64;
+        inline std::mutex scopes_mutex;
+        inline std::array<ScopeStats, MAX_SCOPES> scopes{};
+        inline size_t scope_count{0};
+
+        // Writes straight to stderr: neither snprintf into a stack buffer nor backtrace_symbols_fd allocate.
+        inline auto report(size_t size) -> void
+        {
+            reporting = true;
+            violations.fetch_add(1, std::memory_order_relaxed);
+
+            char line[128];
+            const int length = std::snprintf(line, sizeof(line), "Steady-state allocation of %zu bytes (frame %zu) at:\n", size, frames);
+            [[maybe_unused]] const auto written = write(STDERR_FILENO, line, length);
+
+            void *stack[32];
+            const int depth = backtrace(stack, static_cast<int>(std::size(stack)));
+            // Skip report and allocate
+            if (depth > 2)
+                backtrace_symbols_fd(stack + 2, depth - 2, STDERR_FILENO);
+
+            reporting = false;
+        }
+
+        inline auto on_allocate(size_t size) -> void
+        {
+            totals.allocations.fetch_add(1, std::memory_order_relaxed);
+            totals.bytes.fetch_add(size, std::memory_order_relaxed);
+            thread_counters.allocations++;
+            thread_counters.bytes += size;
+
+            if (steady.load(std::memory_order_relaxed) && not reporting && not exempt) [[unlikely]]
+                report(size);
+        }
+
+        inline auto on_deallocate() -> void
+        {
+            totals.deallocations.fetch_add(1, std::memory_order_relaxed);
+            thread_counters.deallocations++;
+        }
+
+        inline auto allocate(size_t size, size_t alignment) -> void *
+        {
+            on_allocate(size);
+
+            if (alignment <= alignof(std::max_align_t))
+                return std::malloc(size ? size : 1);
+
+            // aligned_alloc wants a multiple of the alignment
+            return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+        }
+
+        inline auto deallocate(void *ptr) -> void
+        {
+            if (not ptr)
+                return;
+
+            on_deallocate();
+            std::free(ptr);
+        }
+
+        inline auto record_scope(const char *name, const Counters &delta) -> void
+        {
+            std::lock_guard lock(scopes_mutex);
+
+            size_t i = 0;
+            while (i < scope_count && scopes[i].name != name)
+                i++;
+
+            if (i == scope_count)
+            {
+                if (scope_count == MAX_SCOPES)
+                    return;
+                scopes[scope_count++] = {name, 0, 0, 0};
+            }
+
+            scopes[i].calls++;
+            scopes[i].allocations += delta.allocations;
+            scopes[i].bytes += delta.bytes;
+        }
+    }
+
+    // Counts the allocations made by the calling thread until the end of the enclosing block. `name` must be a
+    // string literal.
+    class Scope
+    {
+    public:
+        Scope(const char *name) : name(name), begin(_impl::thread_counters) {}
+
+        Scope(const Scope &) = delete;
+        Scope(Scope &&) = delete;
+        inline auto operator=(const Scope &) = delete;
+        inline auto operator=(Scope &&) = delete;
+
+        ~Scope()
+        {
+            _impl::record_scope(name, _impl::thread_counters - begin);
+        }
+
+    private:
+        const char *name;
+        Counters begin;
+    };
+
+    // Allocations of the calling thread are not reported until the end of the enclosing block, e.g. for periodic
+    // diagnostics that are allowed to allocate. They are still counted.
+    class Exempt
+    {
+    public:
+        Exempt()
+        {
+            _impl::exempt++;
+        }
+
+        Exempt(const Exempt &) = delete;
+        Exempt(Exempt &&) = delete;
+        inline auto operator=(const Exempt &) = delete;
+        inline auto operator=(Exempt &&) = delete;
+
+        ~Exempt()
+        {
+            _impl::exempt--;
+        }
+    };
+
+    // Totals of every thread since startup.
+    inline auto get_total_counters() -> Counters
+    {
+        return _impl::totals.load();
+    }
+
+    // Allocations of every thread during the last completed frame.
+    inline auto get_frame_counters() -> const Counters &
+    {
+        return _impl::last_frame;
+    }
+
+    // Report every allocation from now on (or stop doing so).
+    inline auto set_steady_state(bool value) -> void
+    {
+        if (value)
+        {
+            // The first backtrace loads the unwinder, which allocates; get that out of the way.
+            _impl::reporting = true;
+            void *stack[1];
+            backtrace(stack, 1);
+            _impl::reporting = false;
+        }
+
+        _impl::steady = value;
+    }
+
+    // Enter the steady state once this many frames have passed, e.g. after loading and warm-up. Zero disables it.
+    inline auto set_steady_state_after(size_t frames) -> void
+    {
+        _impl::steady_after = frames;
+    }
+
+    inline auto is_steady_state() -> bool
+    {
+        return _impl::steady.load(std::memory_order_relaxed);
+    }
+
+    // Allocations reported during steady-state frames.
+    inline auto get_violation_count() -> size_t
+    {
+        return _impl::violations.load(std::memory_order_relaxed);
+    }
+
+    // Frame boundary, main thread only.
+    inline auto next_frame() -> void
+    {
+        const auto now = _impl::totals.load();
+        _impl::last_frame = now - _impl::frame_begin;
+        _impl::frame_begin = now;
+
+        if (++_impl::frames == _impl::steady_after)
+            set_steady_state(true);
+    }
+
+    // Copies the stats of the ALLOC_SCOPEs seen so far into `out`, returns how many there were.
+    inline auto get_scope_stats(ScopeStats *out, size_t capacity) -> size_t
+    {
+        std::lock_guard lock(_impl::scopes_mutex);
+
+        const size_t count = std::min(capacity, _impl::scope_count);
+        std::copy(_impl::scopes.begin(), _impl::scopes.begin() + count, out);
+        return count;
+    }
+
+    inline auto dump(const Log::Logger &logger = Log::debug) -> void
+    {
+        if (not logger.is_active())
+            return;
+
+        const auto frame = get_frame_counters();
+        logger(Log::format("Allocations: %zu allocation(s) of %zu bytes and %zu deallocation(s) last frame, %zu steady-state violation(s)",
+                           frame.allocations, frame.bytes, frame.deallocations, get_violation_count()));
+
+        std::array<ScopeStats, _impl::MAX_SCOPES> stats;
+        const size_t count = get_scope_stats(stats.data(), stats.size());
+        for (size_t i = 0; i < count; i++)
+        {
+            const auto &scope = stats[i];
+            logger(Log::format("%s: %zu call(s), %.2f allocation(s) and %.1f bytes per call", scope.name, scope.calls,
+                               static_cast<double>(scope.allocations) / scope.calls, static_cast<double>(scope.bytes) / scope.calls));
+        }
+    }
+}
+
+// Replacements of the global allocation functions. These may not be inline, hence the single translation unit rule.
+auto operator new(size_t size) -> void *
+{
+    if (void *ptr = Memory::_impl::allocate(size, 0))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+auto operator new[](size_t size) -> void *
+{
+    return operator new(size);
+}
+
+auto operator new(size_t size, std::align_val_t alignment) -> void *
+{
+    if (void *ptr = Memory::_impl::allocate(size, static_cast<size_t>(alignment)))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+auto operator new[](size_t size, std::align_val_t alignment) -> void *
+{
+    return operator new(size, alignment);
+}
+
+auto operator new(size_t size, const std::nothrow_t &) noexcept -> void *
+{
+    return Memory::_impl::allocate(size, 0);
+}
+
+auto operator new[](size_t size, const std::nothrow_t &) noexcept -> void *
+{
+    return Memory::_impl::allocate(size, 0);
+}
+
+auto operator delete(void *ptr) noexcept -> void
+{
+    Memory::_impl::deallocate(ptr);
+}
+
+auto operator delete[](void *ptr) noexcept -> void
+{
+    Memory::_impl::deallocate(ptr);
+}
+
+auto operator delete(void *ptr, size_t) noexcept -> void
+{
+    Memory::_impl::deallocate(ptr);
+}
+
+auto operator delete[](void *ptr, size_t) noexcept -> void
+{
+    Memory::_impl::deallocate(ptr);
+}
+
+auto operator delete(void *ptr, std::align_val_t) noexcept -> void
+{
+    Memory::_impl::deallocate(ptr);
+}
+
+auto operator delete[](void *ptr, std::align_val_t) noexcept -> void
+{
+    Memory::_impl::deallocate(ptr);
+}
+
+auto operator delete(void *ptr, size_t, std::align_val_t) noexcept -> void
+{
+    Memory::_impl::deallocate(ptr);
+}
+
+auto operator delete[](void *ptr, size_t, std::align_val_t) noexcept -> void
+{
+    Memory::_impl::deallocate(ptr);
+}
+
+#else
+
+#define ALLOC_SCOPE(name)
+#define ALLOC_NEXT_FRAME()
+#define ALLOC_EXEMPT()
+
+#endif
+
+#include <sys/resource.h>
+
+#include <cstddef>
+
+namespace Memory
+{
+    // Largest resident set size of the process so far, in bytes. Available with or without ALLOC_TRACKING.
+    inline auto get_peak_rss() -> size_t
+    {
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+
+#ifdef __APPLE__
+        return static_cast<size_t>(usage.ru_maxrss); // Bytes
+#else
+        return static_cast<size_t>(usage.ru_maxrss) * 1024; // Kilobytes
+#endif
+    }
+}
+
+#endif
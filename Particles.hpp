@@ -0,0 +1,245 @@
+#ifndef PARTICLES_HPP
+#define PARTICLES_HPP
+
+#include "ECS.hpp"
+#include "Error.hpp"
+#include "Graphics.hpp"
+#include "Profile.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+Short-lived particles (thrust, explosions) kept out of the ECS: a ParticleSystem stores a fixed number of them as
+structure-of-arrays, integrates them four at a time with SSE2 (scalar elsewhere) and swap-removes them when they
+expire, so spawning and killing never allocates or touches a component pool.
+Emitters are ordinary components next to a Graphics::Transform2D; ParticleSystem::emit spawns from all of them.
+*/
+
+namespace Particles
+{
+    // Spawns particles at the entity's position, moving away along `direction` (relative to its rotation).
+    struct Emitter
+    {
+        // Particles per second, continuously
+        float rate{0.0f};
+        // Particles spawned at once on the next emit, e.g. an explosion
+        size_t burst{0};
+        // Radians; particles leave within `spread` to either side
+        float direction{3.1415927f}, spread{0.3f};
+        float speed{0.5f};
+        // Seconds, shortened at random by up to half
+        float lifetime{0.4f};
+        float size{0.01f};
+        Graphics::Color color{1.0f, 1.0f, 1.0f};
+
+        float pending{0.0f}; // Fraction of a particle carried over to the next emit
+    };
+
+    namespace _impl
+    {
+        // Advances `count` particles by `dt`. Velocities are multiplied by `damping` every step.
+        inline auto integrate_scalar(float *x, float *y, float *vx, float *vy, float *life, size_t count, float dt, float damping) -> void
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                x[i] += vx[i] * dt;
+                y[i] += vy[i] * dt;
+                vx[i] *= damping;
+                vy[i] *= damping;
+                life[i] -= dt;
+            }
+        }
+
+#ifdef __SSE2__
+        // Same as integrate_scalar; the arrays must be padded to a multiple of four elements.
+        inline auto integrate_simd(float *x, float *y, float *vx, float *vy, float *life, size_t count, float dt, float damping) -> void
+        {
+            const __m128 step = _mm_set1_ps(dt), damp = _mm_set1_ps(damping);
+            for (size_t i = 0; i < count; i += 4)
+            {
+                const __m128 velocity_x = _mm_loadu_ps(vx + i), velocity_y = _mm_loadu_ps(vy + i);
+                _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(velocity_x, step)));
+                _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(velocity_y, step)));
+                _mm_storeu_ps(vx + i, _mm_mul_ps(velocity_x, damp));
+                _mm_storeu_ps(vy + i, _mm_mul_ps(velocity_y, damp));
+                _mm_storeu_ps(life + i, _mm_sub_ps(_mm_loadu_ps(life + i), step));
+            }
+        }
+#endif
+    }
+
+    class ParticleSystem
+    {
+    public:
+        using Instance = Graphics::ParticleRenderer2D::Instance;
+
+        ParticleSystem(size_t capacity)
+            : capacity(capacity)
+        {
+            // Padded, so the SIMD loop may run past the last particle.
+            const size_t padded = (capacity + 3) / 4 * 4;
+            for (auto *array : {&x, &y, &vx, &vy, &life, &inv_lifetime, &sizes})
+                array->resize(padded, 0.0f);
+            colors.resize(padded, 0);
+        }
+
+        ParticleSystem(const ParticleSystem &) = delete;
+        ParticleSystem(ParticleSystem &&) = delete;
+        inline auto operator=(const ParticleSystem &) = delete;
+        inline auto operator=(ParticleSystem &&) = delete;
+
+        // Velocity retained per second, 1 keeps particles at constant speed.
+        inline auto set_damping(float value) -> ParticleSystem &
+        {
+            damping = value;
+            return *this;
+        }
+
+        // Switches between the SIMD and the scalar update, e.g. to compare them. Ignored without SSE2.
+        inline auto set_simd(bool value) -> ParticleSystem &
+        {
+            simd = value;
+            return *this;
+        }
+
+        // False (and counted as dropped) when the system is full.
+        inline auto spawn(Graphics::Vec2 position, Graphics::Vec2 velocity, float lifetime, float size, uint32_t color) -> bool
+        {
+            if (count == capacity)
+            {
+                dropped++;
+                return false;
+            }
+
+            x[count] = position.x;
+            y[count] = position.y;
+            vx[count] = velocity.x;
+            vy[count] = velocity.y;
+            life[count] = lifetime;
+            inv_lifetime[count] = 1.0f / lifetime;
+            sizes[count] = size;
+            colors[count] = color;
+            count++;
+            return true;
+        }
+
+        // Spawns the particles every Emitter of the scene produces over `dt` seconds.
+        inline auto emit(ECS::Scene &scene, float dt) -> void
+        {
+            PROFILE_SCOPE("ParticleSystem::emit");
+
+            for (auto [id, transform, emitter] : scene.view<Graphics::Transform2D, Emitter>())
+            {
+                emitter.pending += emitter.rate * dt;
+                size_t spawned = emitter.burst + static_cast<size_t>(emitter.pending);
+                emitter.pending -= static_cast<size_t>(emitter.pending);
+                emitter.burst = 0;
+
+                const uint32_t packed = Graphics::ParticleRenderer2D::pack_color(emitter.color);
+                const float heading = transform.rotation + emitter.direction;
+                for (; spawned; spawned--)
+                {
+                    const float angle = heading + emitter.spread * random_signed();
+                    const float speed = emitter.speed * (0.5f + 0.5f * random_unit());
+                    if (not spawn({transform.x, transform.y}, {speed * std::cos(angle), speed * std::sin(angle)},
+                                  emitter.lifetime * (1.0f - 0.5f * random_unit()), emitter.size, packed))
+                        break;
+                }
+            }
+        }
+
+        // Moves every particle and removes the ones that expired.
+        inline auto update(float dt) -> void
+        {
+            PROFILE_SCOPE("ParticleSystem::update");
+
+            const float step_damping = std::pow(damping, dt);
+#ifdef __SSE2__
+            if (simd)
+                _impl::integrate_simd(x.data(), y.data(), vx.data(), vy.data(), life.data(), count, dt, step_damping);
+            else
+#endif
+                _impl::integrate_scalar(x.data(), y.data(), vx.data(), vy.data(), life.data(), count, dt, step_damping);
+
+            // The last particle takes the place of an expired one, so the arrays stay dense.
+            for (size_t i = 0; i < count;)
+            {
+                if (life[i] > 0.0f)
+                {
+                    i++;
+                    continue;
+                }
+
+                count--;
+                x[i] = x[count];
+                y[i] = y[count];
+                vx[i] = vx[count];
+                vy[i] = vy[count];
+                life[i] = life[count];
+                inv_lifetime[i] = inv_lifetime[count];
+                sizes[i] = sizes[count];
+                colors[i] = colors[count];
+            }
+        }
+
+        // Writes one instance per live particle to `out`, which must have room for size() of them.
+        inline auto write_instances(Instance *out) const -> void
+        {
+            for (size_t i = 0; i < count; i++)
+                out[i] = {x[i], y[i], sizes[i], life[i] * inv_lifetime[i], colors[i]};
+        }
+
+        inline auto clear() -> void
+        {
+            count = 0;
+        }
+
+        inline auto size() const -> size_t
+        {
+            return count;
+        }
+
+        inline auto get_capacity() const -> size_t
+        {
+            return capacity;
+        }
+
+        // Spawns refused because the system was full.
+        inline auto get_dropped_count() const -> size_t
+        {
+            return dropped;
+        }
+
+    private:
+        // xorshift32: cheap and good enough to scatter particles.
+        inline auto random_unit() -> float
+        {
+            rng ^= rng << 13;
+            rng ^= rng >> 17;
+            rng ^= rng << 5;
+            return static_cast<float>(rng >> 8) * (1.0f / 16777216.0f);
+        }
+
+        inline auto random_signed() -> float
+        {
+            return 2.0f * random_unit() - 1.0f;
+        }
+
+        size_t capacity, count{0}, dropped{0};
+        float damping{1.0f};
+        bool simd{true};
+        uint32_t rng{0x9E3779B9u};
+
+        std::vector<float> x, y, vx, vy, life, inv_lifetime, sizes;
+        std::vector<uint32_t> colors;
+    };
+}
+
+#endif
@@ -0,0 +1,239 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include "Error.hpp"
+
+/*
+Scoped timeline profiling. PROFILE_SCOPE("name") times the rest of the enclosing block on the calling thread. Nothing
+is recorded until a capture is requested with Profile::capture(frames, path): the next `frames` frames (delimited by
+Profile::next_frame, called by Window::on_update) are then written to `path` as Chrome Trace Event JSON, which
+chrome://tracing and ui.perfetto.dev open.
+
+Names must be string literals (or otherwise outlive the capture). Without PROFILE_ENABLED every macro expands to
+nothing.
+*/
+
+#ifdef PROFILE_ENABLED
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#define PROFILE_SCOPE(name) const Profile::Scope PROFILE_CONCAT(_profile_scope_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#define PROFILE_THREAD_NAME(name) Profile::set_thread_name(name)
+#define PROFILE_NEXT_FRAME() Profile::next_frame()
+
+namespace Profile
+{
+    namespace _impl
+    {
+        inline auto now_ns() -> int64_t
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        struct Event
+        {
+            const char *name;
+            int64_t begin_ns, end_ns;
+        };
+
+        // Events of one thread. Only its owner appends; the lock is uncontended except while a capture is written.
+        struct ThreadBuffer
+        {
+            std::mutex mutex;
+            std::vector<Event> events;
+            std::string name;
+            size_t id;
+        };
+
+        struct Registry
+        {
+            std::mutex mutex;
+            // Owned here, so the events of threads that have exited survive until they are written.
+            std::vector<std::unique_ptr<ThreadBuffer>> threads;
+
+            std::atomic<bool> capturing{false};
+            std::atomic<size_t> frames_requested{0};
+            size_t frames_left{0};
+            std::string path;
+            int64_t origin_ns{0};
+        };
+
+        inline auto registry() -> Registry &
+        {
+            static Registry instance;
+            return instance;
+        }
+
+        inline auto thread_buffer() -> ThreadBuffer &
+        {
+            thread_local ThreadBuffer *buffer = []
+            {
+                auto &reg = registry();
+                std::lock_guard lock(reg.mutex);
+
+                reg.threads.push_back(std::make_unique<ThreadBuffer>());
+                auto &created = *reg.threads.back();
+                created.id = reg.threads.size();
+                created.name = Log::format("Thread %zu", created.id);
+                created.events.reserve(1 << 14);
+                return &created;
+            }();
+            return *buffer;
+        }
+
+        inline auto write_escaped(std::FILE *file, const char *str) -> void
+        {
+            for (; *str; str++)
+            {
+                if (*str == '"' || *str == '\\')
+                    std::fputc('\\', file);
+                std::fputc(*str, file);
+            }
+        }
+
+        // Called with the registry locked, after capturing was switched off.
+        inline auto write_capture(Registry &reg) -> void
+        {
+            std::FILE *file = std::fopen(reg.path.c_str(), "w");
+            SOFT_ASSERT(file, "Could not open the profile capture file");
+            if (not file)
+                return;
+
+            size_t count{0};
+            std::fputs("{\"traceEvents\":[\n", file);
+            for (const auto &thread : reg.threads)
+            {
+                std::lock_guard lock(thread->mutex);
+
+                std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"",
+                             count++ ? ",\n" : "", thread->id);
+                write_escaped(file, thread->name.c_str());
+                std::fputs("\"}}", file);
+
+                for (const auto &event : thread->events)
+                {
+                    std::fputs(",\n{\"name\":\"", file);
+                    write_escaped(file, event.name);
+                    std::fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}", thread->id,
+                                 (event.begin_ns - reg.origin_ns) / 1e3, (event.end_ns - event.begin_ns) / 1e3);
+                    count++;
+                }
+                thread->events.clear();
+            }
+            std::fputs("\n]}\n", file);
+            std::fclose(file);
+
+            LOG_INFO("Wrote %zu profile event(s) of %zu frame(s) to %s", count, reg.frames_requested.load(), reg.path.c_str());
+        }
+    }
+
+    class Scope
+    {
+    public:
+        Scope(const char *name) : name(name)
+        {
+            if (_impl::registry().capturing.load(std::memory_order_relaxed))
+                begin_ns = _impl::now_ns();
+        }
+
+        Scope(const Scope &) = delete;
+        Scope(Scope &&) = delete;
+        inline auto operator=(const Scope &) = delete;
+        inline auto operator=(Scope &&) = delete;
+
+        ~Scope()
+        {
+            if (not begin_ns)
+                return;
+
+            const auto end_ns = _impl::now_ns();
+            auto &buffer = _impl::thread_buffer();
+            std::lock_guard lock(buffer.mutex);
+            buffer.events.push_back({name, begin_ns, end_ns});
+        }
+
+    private:
+        const char *name;
+        int64_t begin_ns{0};
+    };
+
+    // Shown instead of "Thread N" in the trace.
+    inline auto set_thread_name(const char *name) -> void
+    {
+        auto &buffer = _impl::thread_buffer();
+        std::lock_guard lock(buffer.mutex);
+        buffer.name = name;
+    }
+
+    // Records the next `frames` frames and writes them to `path`. Ignored while a capture is running.
+    inline auto capture(size_t frames, std::string path = "profile.json") -> void
+    {
+        auto &reg = _impl::registry();
+        std::lock_guard lock(reg.mutex);
+
+        if (not frames || reg.capturing || reg.frames_requested)
+            return;
+
+        reg.frames_requested = frames;
+        reg.path = std::move(path);
+        LOG_INFO("Capturing a profile of the next %zu frame(s)", frames);
+    }
+
+    inline auto is_capturing() -> bool
+    {
+        return _impl::registry().capturing.load(std::memory_order_relaxed);
+    }
+
+    // Frame boundary: starts a requested capture, or ends the running one once it has covered its frames.
+    inline auto next_frame() -> void
+    {
+        auto &reg = _impl::registry();
+        if (not reg.capturing.load(std::memory_order_relaxed) && not reg.frames_requested)
+            return;
+
+        std::lock_guard lock(reg.mutex);
+        if (reg.capturing)
+        {
+            if (--reg.frames_left)
+                return;
+
+            reg.capturing = false;
+            _impl::write_capture(reg);
+            reg.frames_requested = 0;
+        }
+        else if (reg.frames_requested)
+        {
+            for (const auto &thread : reg.threads)
+            {
+                std::lock_guard thread_lock(thread->mutex);
+                thread->events.clear();
+            }
+
+            reg.frames_left = reg.frames_requested;
+            reg.origin_ns = _impl::now_ns();
+            reg.capturing = true;
+        }
+    }
+}
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD_NAME(name)
+#define PROFILE_NEXT_FRAME()
+
+#endif
+
+#endif
@@ -0,0 +1,717 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include "Graphics.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+/*
+Layers record compact, trivially copyable commands into a CommandBuffer instead of calling GL. A RenderQueue hands each
+finished frame to a render thread that owns the GL context and replays it through a CommandExecutor, while the main
+thread already records the next frame into the other buffer.
+*/
+
+namespace Graphics::Render
+{
+    enum class CommandType : uint8_t
+    {
+        Clear,
+        Viewport,
+        SetViewProjection,
+        DefineMesh,
+        DrawInstances,
+        DrawBatch,
+        DrawText,
+        DrawParticles,
+    };
+
+    // Every command is followed in the buffer by its payload, if it has any.
+
+    struct Clear
+    {
+        static constexpr CommandType TYPE = CommandType::Clear;
+        Color color;
+    };
+
+    struct Viewport
+    {
+        static constexpr CommandType TYPE = CommandType::Viewport;
+        int x, y, width, height;
+    };
+
+    // Uploaded once into the shared FrameUniforms buffer, used by every following draw.
+    struct SetViewProjection
+    {
+        static constexpr CommandType TYPE = CommandType::SetViewProjection;
+        Mat4 matrix;
+    };
+
+    // Payload: Vec2[count], a closed outline in model space. Mesh ids must be defined in order, starting from 0.
+    struct DefineMesh
+    {
+        static constexpr CommandType TYPE = CommandType::DefineMesh;
+        uint32_t mesh, count;
+        Color color;
+    };
+
+    // Payload: Transform2D[count]
+    struct DrawInstances
+    {
+        static constexpr CommandType TYPE = CommandType::DrawInstances;
+        uint32_t mesh, count;
+    };
+
+    // Payload: BatchRenderer2D::Vertex[triangle_vertices + line_vertices], triangles first.
+    struct DrawBatch
+    {
+        static constexpr CommandType TYPE = CommandType::DrawBatch;
+        uint32_t triangle_vertices, line_vertices;
+    };
+
+    // Payload: char[count], not null-terminated. See TextRenderer2D::submit for the layout.
+    struct DrawText
+    {
+        static constexpr CommandType TYPE = CommandType::DrawText;
+        Vec2 position;
+        float size;
+        Color color;
+        uint32_t count;
+    };
+
+    // Payload: ParticleRenderer2D::Instance[count]
+    struct DrawParticles
+    {
+        static constexpr CommandType TYPE = CommandType::DrawParticles;
+        uint32_t count;
+    };
+
+    inline auto command_name(CommandType type) -> const char *
+    {
+        switch (type)
+        {
+        case CommandType::Clear:
+            return "Clear";
+        case CommandType::Viewport:
+            return "Viewport";
+        case CommandType::SetViewProjection:
+            return "SetViewProjection";
+        case CommandType::DefineMesh:
+            return "DefineMesh";
+        case CommandType::DrawInstances:
+            return "DrawInstances";
+        case CommandType::DrawBatch:
+            return "DrawBatch";
+        case CommandType::DrawText:
+            return "DrawText";
+        case CommandType::DrawParticles:
+            return "DrawParticles";
+        default:
+            return "Unknown";
+        }
+    }
+
+    struct FrameStats
+    {
+        size_t commands{0}, command_bytes{0};
+        size_t draw_calls{0}, uploaded_bytes{0};
+        size_t state_issued{0}, state_elided{0};
+        size_t skipped_draws{0};
+    };
+
+    // Replays commands. Implementations run on the render thread.
+    class CommandExecutor
+    {
+    public:
+        virtual ~CommandExecutor() = default;
+
+        virtual inline auto clear(const Clear &command) -> void = 0;
+        virtual inline auto viewport(const Viewport &command) -> void = 0;
+        virtual inline auto set_view_projection(const SetViewProjection &command) -> void = 0;
+        virtual inline auto define_mesh(const DefineMesh &command, const Vec2 *points) -> void = 0;
+        virtual inline auto draw_instances(const DrawInstances &command, const Transform2D *transforms) -> void = 0;
+        virtual inline auto draw_batch(const DrawBatch &command, const BatchRenderer2D::Vertex *vertices) -> void = 0;
+        virtual inline auto draw_text(const DrawText &command, const char *characters) -> void = 0;
+        virtual inline auto draw_particles(const DrawParticles &command, const ParticleRenderer2D::Instance *particles) -> void = 0;
+
+        // Called after the last command of every frame.
+        virtual inline auto end_frame() -> FrameStats = 0;
+    };
+
+    // Per-frame arena of commands. Memory is kept between frames and recorded data never moves,
+    // so payload pointers stay valid while more commands are recorded.
+    class CommandBuffer
+    {
+    public:
+        static constexpr size_t ALIGNMENT = 8;
+        static constexpr size_t BLOCK_SIZE = 1 << 20;
+
+        CommandBuffer() = default;
+        CommandBuffer(const CommandBuffer &) = delete;
+        CommandBuffer(CommandBuffer &&) = delete;
+        inline auto operator=(const CommandBuffer &) = delete;
+        inline auto operator=(CommandBuffer &&) = delete;
+
+        template <typename T>
+        inline auto record(const T &command) -> void
+        {
+            record<T, std::byte>(command, 0);
+        }
+
+        // Records the command and returns uninitialized space for `payload_count` elements of its payload.
+        template <typename T, typename P>
+        inline auto record(const T &command, size_t payload_count) -> P *
+        {
+            static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_copyable_v<P>, "Commands must be POD");
+            static_assert(alignof(T) <= ALIGNMENT && alignof(P) <= ALIGNMENT, "Over-aligned command");
+
+            const size_t size = aligned(sizeof(Header)) + aligned(sizeof(T)) + aligned(payload_count * sizeof(P));
+            std::byte *out = allocate(size);
+
+            const Header header{T::TYPE, static_cast<uint32_t>(size)};
+            std::memcpy(out, &header, sizeof(Header));
+            std::memcpy(out + aligned(sizeof(Header)), &command, sizeof(T));
+
+            commands++;
+            return reinterpret_cast<P *>(out + aligned(sizeof(Header)) + aligned(sizeof(T)));
+        }
+
+        inline auto clear() -> void
+        {
+            for (auto &block : blocks)
+                block.used = 0;
+
+            current = 0;
+            commands = 0;
+        }
+
+        inline auto command_count() const -> size_t
+        {
+            return commands;
+        }
+
+        inline auto size_bytes() const -> size_t
+        {
+            size_t size{0};
+            for (size_t i = 0; i < blocks.size() && i <= current; i++)
+                size += blocks[i].used;
+            return size;
+        }
+
+        // Replays every command in recording order.
+        inline auto execute(CommandExecutor &executor) const -> void
+        {
+            for (size_t i = 0; i < blocks.size() && i <= current; i++)
+            {
+                const auto &block = blocks[i];
+                for (size_t offset = 0; offset < block.used;)
+                {
+                    const std::byte *at = block.data.get() + offset;
+
+                    Header header;
+                    std::memcpy(&header, at, sizeof(Header));
+                    dispatch(executor, header.type, at + aligned(sizeof(Header)));
+
+                    offset += header.size;
+                }
+            }
+        }
+
+    private:
+        struct Header
+        {
+            CommandType type;
+            uint32_t size;
+        };
+
+        struct Block
+        {
+            std::unique_ptr<std::byte[]> data;
+            size_t capacity, used;
+        };
+
+        static constexpr inline auto aligned(size_t size) -> size_t
+        {
+            return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        }
+
+        template <typename T>
+        static inline auto payload_of(const std::byte *command) -> const T *
+        {
+            return reinterpret_cast<const T *>(command);
+        }
+
+        static inline auto dispatch(CommandExecutor &executor, CommandType type, const std::byte *command) -> void
+        {
+            switch (type)
+            {
+            case CommandType::Clear:
+                executor.clear(*payload_of<Clear>(command));
+                break;
+            case CommandType::Viewport:
+                executor.viewport(*payload_of<Viewport>(command));
+                break;
+            case CommandType::SetViewProjection:
+                executor.set_view_projection(*payload_of<SetViewProjection>(command));
+                break;
+            case CommandType::DefineMesh:
+                executor.define_mesh(*payload_of<DefineMesh>(command), payload_of<Vec2>(command + aligned(sizeof(DefineMesh))));
+                break;
+            case CommandType::DrawInstances:
+                executor.draw_instances(*payload_of<DrawInstances>(command), payload_of<Transform2D>(command + aligned(sizeof(DrawInstances))));
+                break;
+            case CommandType::DrawBatch:
+                executor.draw_batch(*payload_of<DrawBatch>(command), payload_of<BatchRenderer2D::Vertex>(command + aligned(sizeof(DrawBatch))));
+                break;
+            case CommandType::DrawText:
+                executor.draw_text(*payload_of<DrawText>(command), payload_of<char>(command + aligned(sizeof(DrawText))));
+                break;
+            case CommandType::DrawParticles:
+                executor.draw_particles(*payload_of<DrawParticles>(command),
+                                        payload_of<ParticleRenderer2D::Instance>(command + aligned(sizeof(DrawParticles))));
+                break;
+            default:
+                ASSERT(false, "Unknown render command");
+            }
+        }
+
+        // Commands never straddle blocks; a command larger than BLOCK_SIZE gets a block of its own.
+        inline auto allocate(size_t size) -> std::byte *
+        {
+            while (current < blocks.size() && blocks[current].used + size > blocks[current].capacity)
+            {
+                if (current + 1 < blocks.size())
+                    blocks[current + 1].used = 0;
+                current++;
+            }
+
+            if (current == blocks.size())
+            {
+                const size_t capacity = std::max(BLOCK_SIZE, size);
+                blocks.push_back({std::make_unique<std::byte[]>(capacity), capacity, 0});
+            }
+
+            auto &block = blocks[current];
+            std::byte *out = block.data.get() + block.used;
+            block.used += size;
+            return out;
+        }
+
+        std::vector<Block> blocks;
+        size_t current{0};
+        size_t commands{0};
+    };
+
+    // Executes commands with the GL renderers of Graphics.hpp. GL objects are created lazily, on the render thread.
+    // Until their shaders have compiled, the renderers' draws are skipped rather than waited for.
+    class GLExecutor : public CommandExecutor
+    {
+    public:
+        virtual inline auto clear(const Clear &command) -> void override
+        {
+            flush();
+            backend().clear(command.color.r, command.color.g, command.color.b, command.color.a);
+        }
+
+        virtual inline auto viewport(const Viewport &command) -> void override
+        {
+            flush();
+            backend().viewport(command.x, command.y, command.width, command.height);
+        }
+
+        virtual inline auto set_view_projection(const SetViewProjection &command) -> void override
+        {
+            flush();
+            prepare();
+            frame_uniforms->set({command.matrix});
+        }
+
+        virtual inline auto define_mesh(const DefineMesh &command, const Vec2 *points) -> void override
+        {
+            [[maybe_unused]] const size_t mesh = instanced().add_mesh(points, command.count, command.color);
+            ASSERT(mesh == command.mesh, "Meshes must be defined in order");
+        }
+
+        // Consecutive draws of the same kind are merged into a single batch.
+        virtual inline auto draw_instances(const DrawInstances &command, const Transform2D *transforms) -> void override
+        {
+            if (pending != Pending::Instances)
+            {
+                flush();
+                instanced().begin();
+                pending = Pending::Instances;
+            }
+
+            instanced_renderer->submit(command.mesh, transforms, command.count);
+        }
+
+        virtual inline auto draw_batch(const DrawBatch &command, const BatchRenderer2D::Vertex *vertices) -> void override
+        {
+            if (pending != Pending::Batch)
+            {
+                flush();
+                batch().begin();
+                pending = Pending::Batch;
+            }
+
+            batch_renderer->submit_triangles(vertices, command.triangle_vertices);
+            batch_renderer->submit_lines(vertices + command.triangle_vertices, command.line_vertices);
+        }
+
+        virtual inline auto draw_text(const DrawText &command, const char *characters) -> void override
+        {
+            if (pending != Pending::Text)
+            {
+                flush();
+                text().begin();
+                pending = Pending::Text;
+            }
+
+            text_renderer->submit(std::string_view(characters, command.count), command.position, command.size, command.color);
+        }
+
+        virtual inline auto draw_particles(const DrawParticles &command, const ParticleRenderer2D::Instance *instances) -> void override
+        {
+            if (pending != Pending::Particles)
+            {
+                flush();
+                particles().begin();
+                pending = Pending::Particles;
+            }
+
+            particle_renderer->submit(instances, command.count);
+        }
+
+        virtual inline auto end_frame() -> FrameStats override
+        {
+            flush();
+
+            const auto result = stats;
+            stats = FrameStats{};
+            return result;
+        }
+
+    private:
+        enum class Pending
+        {
+            None,
+            Instances,
+            Batch,
+            Text,
+            Particles
+        };
+
+        inline auto flush() -> void
+        {
+            if (pending != Pending::None && not(instanced_renderer->is_ready() && batch_renderer->is_ready() && text_renderer->is_ready() &&
+                                               particle_renderer->is_ready()))
+            {
+                stats.skipped_draws++;
+                pending = Pending::None;
+                return;
+            }
+
+            switch (pending)
+            {
+            case Pending::Instances:
+                instanced_renderer->end();
+                stats.draw_calls += instanced_renderer->get_stats().draw_calls;
+                stats.uploaded_bytes += instanced_renderer->get_stats().uploaded_bytes;
+                break;
+            case Pending::Batch:
+                batch_renderer->end();
+                stats.draw_calls += batch_renderer->get_stats().draw_calls;
+                stats.uploaded_bytes += batch_renderer->get_stats().uploaded_bytes;
+                break;
+            case Pending::Text:
+                text_renderer->end();
+                stats.draw_calls += text_renderer->get_stats().draw_calls;
+                stats.uploaded_bytes += text_renderer->get_stats().uploaded_bytes;
+                break;
+            case Pending::Particles:
+                particle_renderer->end();
+                stats.draw_calls += particle_renderer->get_stats().draw_calls;
+                stats.uploaded_bytes += particle_renderer->get_stats().uploaded_bytes;
+                break;
+            default:
+                break;
+            }
+
+            pending = Pending::None;
+        }
+
+        inline auto instanced() -> InstancedRenderer2D &
+        {
+            prepare();
+            return *instanced_renderer;
+        }
+
+        inline auto batch() -> BatchRenderer2D &
+        {
+            prepare();
+            return *batch_renderer;
+        }
+
+        inline auto text() -> TextRenderer2D &
+        {
+            prepare();
+            return *text_renderer;
+        }
+
+        inline auto particles() -> ParticleRenderer2D &
+        {
+            prepare();
+            return *particle_renderer;
+        }
+
+        // All renderers are created together so their shaders compile in parallel.
+        inline auto prepare() -> void
+        {
+            if (instanced_renderer)
+                return;
+
+            instanced_renderer = std::make_unique<InstancedRenderer2D>();
+            batch_renderer = std::make_unique<BatchRenderer2D>();
+            text_renderer = std::make_unique<TextRenderer2D>();
+            particle_renderer = std::make_unique<ParticleRenderer2D>();
+            frame_uniforms = std::make_unique<UniformBuffer<FrameUniforms>>(FRAME_UNIFORM_BINDING);
+        }
+
+        std::unique_ptr<UniformBuffer<FrameUniforms>> frame_uniforms;
+        std::unique_ptr<InstancedRenderer2D> instanced_renderer;
+        std::unique_ptr<BatchRenderer2D> batch_renderer;
+        std::unique_ptr<TextRenderer2D> text_renderer;
+        std::unique_ptr<ParticleRenderer2D> particle_renderer;
+        Pending pending{Pending::None};
+        FrameStats stats;
+    };
+
+    // Keeps a trace of the commands of the last frame instead of drawing, e.g. for headless runs and tests.
+    class RecordingExecutor : public CommandExecutor
+    {
+    public:
+        struct Call
+        {
+            CommandType type;
+            size_t count;
+            size_t payload_bytes;
+        };
+
+        virtual inline auto clear(const Clear &) -> void override
+        {
+            calls.push_back({CommandType::Clear, 0, 0});
+        }
+
+        virtual inline auto viewport(const Viewport &) -> void override
+        {
+            calls.push_back({CommandType::Viewport, 0, 0});
+        }
+
+        virtual inline auto set_view_projection(const SetViewProjection &) -> void override
+        {
+            calls.push_back({CommandType::SetViewProjection, 1, sizeof(FrameUniforms)});
+        }
+
+        virtual inline auto define_mesh(const DefineMesh &command, const Vec2 *) -> void override
+        {
+            calls.push_back({CommandType::DefineMesh, command.count, command.count * sizeof(Vec2)});
+        }
+
+        virtual inline auto draw_instances(const DrawInstances &command, const Transform2D *) -> void override
+        {
+            calls.push_back({CommandType::DrawInstances, command.count, command.count * sizeof(Transform2D)});
+        }
+
+        virtual inline auto draw_batch(const DrawBatch &command, const BatchRenderer2D::Vertex *) -> void override
+        {
+            const size_t count = command.triangle_vertices + command.line_vertices;
+            calls.push_back({CommandType::DrawBatch, count, count * sizeof(BatchRenderer2D::Vertex)});
+        }
+
+        virtual inline auto draw_text(const DrawText &command, const char *) -> void override
+        {
+            calls.push_back({CommandType::DrawText, command.count, command.count});
+        }
+
+        virtual inline auto draw_particles(const DrawParticles &command, const ParticleRenderer2D::Instance *) -> void override
+        {
+            calls.push_back({CommandType::DrawParticles, command.count, command.count * sizeof(ParticleRenderer2D::Instance)});
+        }
+
+        virtual inline auto end_frame() -> FrameStats override
+        {
+            last_frame.swap(calls);
+            calls.clear();
+
+            FrameStats stats;
+            for (const auto &call : last_frame)
+                stats.uploaded_bytes += call.payload_bytes;
+            return stats;
+        }
+
+        // Calls of the last completed frame.
+        inline auto get_calls() const -> const std::vector<Call> &
+        {
+            return last_frame;
+        }
+
+        inline auto dump(const Log::Logger &logger = Log::debug) const -> void
+        {
+            if (not logger.is_active())
+                return;
+
+            for (const auto &call : last_frame)
+                logger(Log::format("%s: %zu element(s), %zu bytes", command_name(call.type), call.count, call.payload_bytes));
+        }
+
+    private:
+        std::vector<Call> calls, last_frame;
+    };
+
+    /*
+    Double-buffered hand-off between the main thread, which records frame N + 1 into commands(), and the render thread,
+    which executes frame N and presents it. submit() only blocks if the render thread is still busy with frame N.
+    The render thread owns the window's GL context until the queue is destroyed.
+    */
+    class RenderQueue
+    {
+    public:
+        RenderQueue(Window &window, std::unique_ptr<CommandExecutor> executor)
+            : window(window), executor(std::move(executor))
+        {
+            window.release_context();
+            thread = std::thread(&RenderQueue::render_loop, this);
+        }
+
+        RenderQueue(const RenderQueue &) = delete;
+        RenderQueue(RenderQueue &&) = delete;
+        inline auto operator=(const RenderQueue &) = delete;
+        inline auto operator=(RenderQueue &&) = delete;
+
+        ~RenderQueue()
+        {
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            work_ready.notify_one();
+            thread.join();
+
+            window.reclaim_context();
+        }
+
+        // The frame being recorded. Main thread only.
+        inline auto commands() -> CommandBuffer &
+        {
+            return frames[recording];
+        }
+
+        // Hands the recorded frame to the render thread and starts recording the next one.
+        inline auto submit() -> void
+        {
+            PROFILE_SCOPE("RenderQueue::submit");
+            std::unique_lock lock(mutex);
+            frame_done.wait(lock, [this]
+                            { return not pending; });
+
+            rendering = recording;
+            recording ^= 1;
+            pending = true;
+            lock.unlock();
+
+            work_ready.notify_one();
+            frames[recording].clear();
+        }
+
+        // Stats of the last frame the render thread finished.
+        inline auto get_frame_stats() const -> FrameStats
+        {
+            std::lock_guard lock(mutex);
+            return stats;
+        }
+
+        // Only safe to inspect while no frame is in flight, e.g. after wait_idle.
+        inline auto get_executor() -> CommandExecutor &
+        {
+            return *executor;
+        }
+
+        // Blocks until the render thread has finished every submitted frame.
+        inline auto wait_idle() -> void
+        {
+            std::unique_lock lock(mutex);
+            frame_done.wait(lock, [this]
+                            { return not pending; });
+        }
+
+    private:
+        inline auto render_loop() -> void
+        {
+            PROFILE_THREAD_NAME("Render");
+            if (not window.is_headless())
+                window.make_current();
+
+            while (true)
+            {
+                std::unique_lock lock(mutex);
+                work_ready.wait(lock, [this]
+                                { return pending || stopping; });
+                if (not pending)
+                    break;
+
+                const auto &frame = frames[rendering];
+                lock.unlock();
+
+                {
+                    PROFILE_SCOPE("RenderQueue::execute");
+                    ALLOC_SCOPE("RenderQueue::execute");
+                    frame.execute(*executor);
+                }
+                auto frame_stats = executor->end_frame();
+                frame_stats.commands = frame.command_count();
+                frame_stats.command_bytes = frame.size_bytes();
+
+                if (not window.is_headless())
+                {
+                    PROFILE_SCOPE("RenderQueue::swap");
+                    window.swap_buffers();
+                }
+
+                state().end_frame();
+                backend().end_frame();
+                frame_stats.state_issued = state().get_frame_counters().issued;
+                frame_stats.state_elided = state().get_frame_counters().elided;
+
+                lock.lock();
+                stats = frame_stats;
+                pending = false;
+                lock.unlock();
+                frame_done.notify_all();
+            }
+
+            // GL objects have to go while the context is still current here.
+            executor.reset();
+            if (not window.is_headless())
+                glfwMakeContextCurrent(nullptr);
+        }
+
+        Window &window;
+        std::unique_ptr<CommandExecutor> executor;
+
+        CommandBuffer frames[2];
+        size_t recording{0}, rendering{1};
+
+        mutable std::mutex mutex;
+        std::condition_variable work_ready, frame_done;
+        bool pending{false}, stopping{false};
+        FrameStats stats;
+
+        std::thread thread;
+    };
+}
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef SCENARIO_HPP
+#define SCENARIO_HPP
+
+#include "ECS.hpp"
+#include "Game.hpp"
+#include "Graphics.hpp"
+#include "Particles.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/*
+Procedural scenes for stress tests: Scenario::populate seeds a Scene with asteroids and bullets, and a ParticleSystem
+with particles, drawn from the distributions of a Scenario::Config. The same seed gives the same scene.
+*/
+
+namespace Scenario
+{
+    enum class Density
+    {
+        // Evenly over the world
+        Uniform,
+        // Normally distributed around `clusters` random centers. Asteroids and bullets crowd into the same grid cells
+        // while most of the grid stays empty, so every bullet is tested against more asteroids than in a uniform scene.
+        Clustered
+    };
+
+    struct Config
+    {
+        size_t asteroids{32}, bullets{0}, particles{0};
+
+        Density density{Density::Uniform};
+        size_t clusters{8};
+        float cluster_radius{0.2f}; // Standard deviation around a center
+
+        // Asteroid scales are uniform in [min_size, max_size].
+        float min_size{0.04f}, max_size{0.15f};
+        // Speeds are uniform in [0, max speed], in random directions. Spin is uniform in [-max_spin, max_spin].
+        float asteroid_speed{0.2f}, max_spin{1.0f};
+        float bullet_speed{1.5f}, particle_speed{0.5f};
+        // Seconds; lifetimes are uniform in [life / 2, life].
+        float bullet_life{1.0f}, particle_life{1.0f};
+
+        uint32_t seed{42};
+
+        // Asteroid sizes and the cluster radius shrink by 1 / sqrt(scale) and the number of clusters grows by scale, so
+        // that the scene covers about as much of the world at any object count and every cluster stays as crowded
+        // relative to its asteroids' size as in the base configuration.
+        inline auto scaled(size_t asteroids, size_t bullets, size_t particles, float scale) const -> Config
+        {
+            Config config = *this;
+            config.asteroids = asteroids;
+            config.bullets = bullets;
+            config.particles = particles;
+            config.min_size /= std::sqrt(scale);
+            config.max_size /= std::sqrt(scale);
+            config.cluster_radius /= std::sqrt(scale);
+            config.clusters = std::max<size_t>(1, static_cast<size_t>(clusters * scale));
+            return config;
+        }
+    };
+
+    namespace _impl
+    {
+        class Sampler
+        {
+        public:
+            Sampler(const Config &config) : config(config), rng(config.seed)
+            {
+                std::uniform_real_distribution<float> x(-Game::WORLD_HALF_WIDTH, Game::WORLD_HALF_WIDTH), y(-1.0f, 1.0f);
+                if (config.density == Density::Clustered)
+                {
+                    centers.reserve(config.clusters);
+                    for (size_t i = 0; i < config.clusters; i++)
+                        centers.push_back({x(rng), y(rng)});
+                }
+            }
+
+            inline auto position() -> Graphics::Vec2
+            {
+                std::uniform_real_distribution<float> x(-Game::WORLD_HALF_WIDTH, Game::WORLD_HALF_WIDTH), y(-1.0f, 1.0f);
+                if (centers.empty())
+                    return {x(rng), y(rng)};
+
+                // Wrapped into the world like everything that moves.
+                std::normal_distribution<float> offset(0.0f, config.cluster_radius);
+                const auto &center = centers[rng() % centers.size()];
+                return {wrap(center.x + offset(rng), Game::WORLD_HALF_WIDTH), wrap(center.y + offset(rng), 1.0f)};
+            }
+
+            // Random direction, speed uniform in [0, max_speed].
+            inline auto velocity(float max_speed) -> Graphics::Vec2
+            {
+                const float angle = uniform(0.0f, 6.2831853f), speed = uniform(0.0f, max_speed);
+                return {speed * std::cos(angle), speed * std::sin(angle)};
+            }
+
+            inline auto uniform(float min, float max) -> float
+            {
+                return std::uniform_real_distribution<float>(min, max)(rng);
+            }
+
+            inline auto index(size_t first, size_t last) -> size_t
+            {
+                return std::uniform_int_distribution<size_t>(first, last)(rng);
+            }
+
+        private:
+            static inline auto wrap(float value, float half) -> float
+            {
+                return value - 2.0f * half * std::floor((value + half) / (2.0f * half));
+            }
+
+            const Config &config;
+            std::mt19937 rng;
+            std::vector<Graphics::Vec2> centers;
+        };
+    }
+
+    // Adds the configured asteroids and bullets to the scene (each kind as one block of entities) and spawns the
+    // particles, up to the system's capacity. Returns the number of particles spawned.
+    inline auto populate(const Config &config, ECS::Scene &scene, Game::AsteroidPrefab &asteroid_prefab,
+                         Game::BulletPrefab &bullet_prefab, Particles::ParticleSystem &particles) -> size_t
+    {
+        _impl::Sampler sample(config);
+
+        const size_t entities = config.asteroids + config.bullets;
+        scene.reserve_entity(entities);
+        scene.reserve_component<Graphics::Transform2D>(entities);
+        scene.reserve_component<Game::Velocity>(entities);
+        scene.reserve_component<Game::Shape>(entities);
+
+        std::vector<ECS::EntityID> created(std::max(config.asteroids, config.bullets));
+
+        scene.instantiate(asteroid_prefab, created.data(), config.asteroids);
+        for (size_t i = 0; i < config.asteroids; i++)
+        {
+            auto [transform, velocity, shape] = scene.get_all<Graphics::Transform2D, Game::Velocity, Game::Shape>(created[i]);
+            const auto position = sample.position(), drift = sample.velocity(config.asteroid_speed);
+            transform = {position.x, position.y, sample.uniform(0.0f, 6.2831853f), sample.uniform(config.min_size, config.max_size)};
+            velocity = {drift.x, drift.y, sample.uniform(-config.max_spin, config.max_spin)};
+            shape.index = sample.index(1, Game::ASTEROID_SHAPES);
+        }
+
+        scene.instantiate(bullet_prefab, created.data(), config.bullets);
+        for (size_t i = 0; i < config.bullets; i++)
+        {
+            auto [transform, velocity, bullet] = scene.get_all<Graphics::Transform2D, Game::Velocity, Game::Bullet>(created[i]);
+            const auto position = sample.position();
+            const float angle = sample.uniform(0.0f, 6.2831853f);
+            transform.x = position.x, transform.y = position.y, transform.rotation = angle;
+            velocity = {config.bullet_speed * std::cos(angle), config.bullet_speed * std::sin(angle), 0.0f};
+            bullet.life = sample.uniform(0.5f * config.bullet_life, config.bullet_life);
+        }
+
+        const uint32_t color = Graphics::ParticleRenderer2D::pack_color({0.9f, 0.9f, 0.8f});
+        size_t spawned{0};
+        for (; spawned < config.particles; spawned++)
+        {
+            if (not particles.spawn(sample.position(), sample.velocity(config.particle_speed),
+                                    sample.uniform(0.5f * config.particle_life, config.particle_life), 0.008f, color))
+                break;
+        }
+        return spawned;
+    }
+}
+
+#endif
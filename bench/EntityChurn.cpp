@@ -0,0 +1,128 @@
+// Cost of short-lived entities (bullets, fragments) in ECS::Scene: a population of long-lived entities while a batch
+// of short-lived ones is killed and respawned every frame, with create/assign/destroy, with Prefab instantiation and
+// with Prefab recycling. Also times iterating a view over the population.
+// Usage: EntityChurn [population=100000] [spawned per frame=1000] [frames=200]
+
+#include "ECS.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Position
+    {
+        float x, y;
+    };
+
+    struct Velocity
+    {
+        float x, y;
+    };
+
+    struct Lifetime
+    {
+        float seconds;
+    };
+
+    enum class Mode
+    {
+        Assign,
+        Instantiate,
+        Recycle
+    };
+
+    using BulletPrefab = ECS::Prefab<Position, Velocity, Lifetime>;
+
+    struct Result
+    {
+        double churn_seconds, iterate_seconds;
+        size_t visited;
+    };
+
+    inline auto spawn(ECS::Scene &scene, BulletPrefab &prefab, Mode mode, ECS::EntityID *out, size_t count) -> void
+    {
+        switch (mode)
+        {
+        case Mode::Assign:
+            for (size_t i = 0; i < count; i++)
+            {
+                out[i] = scene.create();
+                scene.assign<Position>(out[i], 0.0f, 0.0f);
+                scene.assign<Velocity>(out[i], 1.0f, 1.0f);
+                scene.assign<Lifetime>(out[i], 1.0f);
+            }
+            break;
+        case Mode::Instantiate:
+            scene.instantiate(prefab, out, count);
+            break;
+        case Mode::Recycle:
+            for (size_t i = 0; i < count; i++)
+                out[i] = prefab.spawn(scene);
+            break;
+        }
+    }
+
+    inline auto run(Mode mode, size_t population, size_t batch, size_t frames) -> Result
+    {
+        ECS::Scene scene;
+        BulletPrefab prefab({0.0f, 0.0f}, {1.0f, 1.0f}, {1.0f});
+        prefab.set_recycling(mode == Mode::Recycle);
+
+        // Long-lived entities with a component the bullets lack, so they sit in separate pools too.
+        std::vector<ECS::EntityID> residents(population);
+        ECS::Prefab<Position, Velocity, int> resident({0.0f, 0.0f}, {0.5f, 0.5f}, 0);
+        scene.instantiate(resident, residents.data(), residents.size());
+
+        std::vector<ECS::EntityID> bullets(batch);
+        spawn(scene, prefab, mode, bullets.data(), batch);
+
+        Result result{0.0, 0.0, 0};
+        for (size_t frame = 0; frame < frames; frame++)
+        {
+            const auto start = Clock::now();
+            for (auto bullet : bullets)
+                prefab.release(scene, bullet);
+            spawn(scene, prefab, mode, bullets.data(), batch);
+            const auto churned = Clock::now();
+
+            for (auto [id, position, velocity] : scene.view<Position, Velocity>())
+            {
+                position.x += velocity.x;
+                result.visited++;
+            }
+            const auto iterated = Clock::now();
+
+            result.churn_seconds += std::chrono::duration<double>(churned - start).count();
+            result.iterate_seconds += std::chrono::duration<double>(iterated - churned).count();
+        }
+
+        return result;
+    }
+
+    inline auto report(const char *name, const Result &result, size_t batch, size_t frames) -> void
+    {
+        std::printf("%-12s churn: %8.3f ms/frame (%7.1f ns/entity)  view: %8.3f ms/frame  visited: %zu/frame\n", name,
+                    result.churn_seconds * 1e3 / frames, result.churn_seconds * 1e9 / (static_cast<double>(batch) * frames),
+                    result.iterate_seconds * 1e3 / frames, result.visited / frames);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const size_t population = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    const size_t batch = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000;
+    const size_t frames = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 200;
+
+    std::printf("%zu residents, %zu entities killed and spawned per frame, %zu frames\n", population, batch, frames);
+
+    report("assign", run(Mode::Assign, population, batch, frames), batch, frames);
+    report("instantiate", run(Mode::Instantiate, population, batch, frames), batch, frames);
+    report("recycle", run(Mode::Recycle, population, batch, frames), batch, frames);
+
+    return 0;
+}
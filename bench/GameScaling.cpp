@@ -0,0 +1,137 @@
+// Frame time of the game's systems on generated scenes (Scenario.hpp) of growing size, split into simulation
+// (movement, bullets, particles), collision detection (broad and narrow phase, contacts are not resolved, so the scene
+// stays the same size) and render preparation (instances written into a command buffer, as GameLayer::draw does).
+// Asteroids shrink as their number grows, so every scene covers the world about as densely as the game's default one.
+// Prints the scaling curve as CSV, one row per asteroid count.
+// Usage: GameScaling [asteroids=1000,10000,100000,1000000] [frames=10] [bullets per asteroid=0.1]
+//                    [particles per asteroid=1] [clustered=0]
+
+#include "Game.hpp"
+#include "Memory.hpp"
+#include "Scenario.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr float DT = 1.0f / 60.0f;
+
+    // Frames run before measuring, so buffers have grown to their steady-state size.
+    constexpr size_t WARMUP_FRAMES = 2;
+
+    // Asteroid count of the game's default scene, which the base configuration is sized for.
+    constexpr size_t REFERENCE_ASTEROIDS = 32;
+
+    struct Result
+    {
+        double simulation, collision, render; // Seconds, summed over the measured frames
+        size_t pairs, prefiltered, contacts;  // Of the last frame
+    };
+
+    inline auto seconds_since(Clock::time_point start) -> double
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    inline auto run(const Scenario::Config &config, size_t frames) -> Result
+    {
+        ECS::Scene scene;
+        Game::AsteroidPrefab asteroid_prefab({}, {0.0f, 0.0f, 0.0f}, {1}, {});
+        Game::BulletPrefab bullet_prefab({0.0f, 0.0f, 0.0f, 0.012f}, {0.0f, 0.0f, 0.0f}, {Game::BULLET_SHAPE}, {1.0f});
+        Particles::ParticleSystem particles(std::max<size_t>(1, config.particles));
+        Scenario::populate(config, scene, asteroid_prefab, bullet_prefab, particles);
+
+        std::mt19937 rng(config.seed);
+        const auto shapes = Game::make_shapes(rng);
+
+        // Cells hold a few asteroids on average, but are never smaller than the largest one.
+        const float area = 4.0f * Game::WORLD_HALF_WIDTH;
+        Game::Collisions collisions;
+        collisions.set_shapes(shapes).set_cell_size(std::max(config.max_size, 2.0f * std::sqrt(area / std::max<size_t>(1, config.asteroids))));
+
+        Graphics::Render::CommandBuffer commands;
+        std::vector<uint32_t> mesh_counts(shapes.size());
+        std::vector<Graphics::Transform2D *> mesh_instances(shapes.size());
+
+        Result result{0.0, 0.0, 0.0, 0, 0, 0};
+        for (size_t frame = 0; frame < WARMUP_FRAMES + frames; frame++)
+        {
+            auto start = Clock::now();
+            Game::move(scene, DT);
+            for (auto [id, bullet] : scene.view<Game::Bullet>())
+                bullet.life -= DT;
+            particles.update(DT);
+            const double simulation = seconds_since(start);
+
+            start = Clock::now();
+            collisions.detect(scene);
+            const double collision = seconds_since(start);
+
+            start = Clock::now();
+            commands.clear();
+            Game::record_meshes(scene, commands, mesh_counts, mesh_instances);
+            if (const auto count = static_cast<uint32_t>(particles.size()))
+                particles.write_instances(commands.record<Graphics::Render::DrawParticles, Graphics::ParticleRenderer2D::Instance>({count}, count));
+            const double render = seconds_since(start);
+
+            if (frame < WARMUP_FRAMES)
+                continue;
+
+            result.simulation += simulation;
+            result.collision += collision;
+            result.render += render;
+        }
+
+        const auto &stats = collisions.get_stats();
+        result.pairs = stats.pairs;
+        result.prefiltered = stats.prefiltered;
+        result.contacts = stats.contacts;
+        return result;
+    }
+
+    inline auto parse_counts(const char *list) -> std::vector<size_t>
+    {
+        std::vector<size_t> counts;
+        for (char *end = nullptr; *list; list = *end ? end + 1 : end)
+            counts.push_back(std::strtoull(list, &end, 10));
+        return counts;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const auto counts = parse_counts(argc > 1 ? argv[1] : "1000,10000,100000,1000000");
+    const size_t frames = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10;
+    const double bullets_per_asteroid = argc > 3 ? std::strtod(argv[3], nullptr) : 0.1;
+    const double particles_per_asteroid = argc > 4 ? std::strtod(argv[4], nullptr) : 1.0;
+    const bool clustered = argc > 5 && std::strtoul(argv[5], nullptr, 10);
+
+    // Everything lives far longer than the run, so the counts hold still.
+    Scenario::Config base;
+    base.density = clustered ? Scenario::Density::Clustered : Scenario::Density::Uniform;
+    base.bullet_life = base.particle_life = 1e6f;
+
+    std::printf("asteroids,bullets,particles,simulation_ms,collision_ms,render_prep_ms,frame_ms,pairs,prefiltered,contacts,peak_rss_mib\n");
+    for (const auto asteroids : counts)
+    {
+        const auto bullets = static_cast<size_t>(asteroids * bullets_per_asteroid);
+        const auto particles = static_cast<size_t>(asteroids * particles_per_asteroid);
+        const auto config = base.scaled(asteroids, bullets, particles, static_cast<float>(asteroids) / REFERENCE_ASTEROIDS);
+
+        const auto result = run(config, frames);
+        const double ms = 1e3 / frames;
+        std::printf("%zu,%zu,%zu,%.4f,%.4f,%.4f,%.4f,%zu,%zu,%zu,%.1f\n", asteroids, bullets, particles, result.simulation * ms,
+                    result.collision * ms, result.render * ms, (result.simulation + result.collision + result.render) * ms,
+                    result.pairs, result.prefiltered, result.contacts, Memory::get_peak_rss() / (1024.0 * 1024.0));
+        std::fflush(stdout);
+    }
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Throughput of Log::Logger with many threads logging at once, and of BLOG into one Log::Binary::BinaryLogger per
+// thread for comparison.
+// Usage: LogThroughput [threads=8] [messages per thread=100000]
+
+#include "BinaryLog.hpp"
+#include "Log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Result
+    {
+        double producer_seconds, total_seconds;
+        size_t dropped;
+    };
+
+    inline auto run(Log::Logger &logger, size_t threads, size_t messages) -> Result
+    {
+        const auto dropped_before = Log::dropped_count();
+        const auto start = Clock::now();
+
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&logger, messages, t]()
+                                 {
+                for (size_t i = 0; i < messages; i++)
+                    logger(Log::format("worker %zu message %zu value=%f", t, i, i * 0.5)); });
+        }
+
+        for (auto &worker : workers)
+            worker.join();
+
+        const auto produced = Clock::now();
+        logger.flush();
+        const auto done = Clock::now();
+
+        return {std::chrono::duration<double>(produced - start).count(),
+                std::chrono::duration<double>(done - start).count(),
+                Log::dropped_count() - dropped_before};
+    }
+
+    // Same messages through BLOG: every thread records into its own BinaryLogger, flushed when it is done.
+    inline auto run_binary(size_t threads, size_t messages) -> Result
+    {
+        const auto start = Clock::now();
+        std::vector<double> produced(threads);
+
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&produced, messages, start, t]()
+                                 {
+                Log::Binary::BinaryLogger logger("/dev/null");
+                for (size_t i = 0; i < messages; i++)
+                    BLOG(logger, "worker %zu message %zu value=%f", t, i, i * 0.5);
+                produced[t] = std::chrono::duration<double>(Clock::now() - start).count();
+                logger.flush(); });
+        }
+
+        for (auto &worker : workers)
+            worker.join();
+
+        return {*std::max_element(produced.begin(), produced.end()),
+                std::chrono::duration<double>(Clock::now() - start).count(), 0};
+    }
+
+    inline auto report(const char *name, const Result &result, size_t threads, size_t messages) -> void
+    {
+        const double total = static_cast<double>(threads * messages);
+        std::printf("%-14s producers: %8.3f Mmsg/s (%6.1f ns/msg per thread)  end-to-end: %8.3f Mmsg/s  dropped: %zu\n",
+                    name, total / result.producer_seconds / 1e6, result.producer_seconds * 1e9 / messages,
+                    (total - result.dropped) / result.total_seconds / 1e6, result.dropped);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const size_t threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 8;
+    const size_t messages = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000;
+
+    Log::Logger logger("BENCH", Log::Color::Default, Log::Level::Info);
+    logger
+        .set_flag(Log::Flag::ThreadTag, true)
+        .clear_sinks()
+        .add_sink(std::make_shared<Log::FileSink>("/dev/null", 1 << 20));
+
+    std::printf("%zu threads x %zu messages\n", threads, messages);
+
+    report("sync", run(logger, threads, messages), threads, messages);
+
+    logger.set_async(true);
+    Log::configure_async(4096, Log::Overflow::Block);
+    report("async block", run(logger, threads, messages), threads, messages);
+
+    Log::configure_async(4096, Log::Overflow::Drop);
+    report("async drop", run(logger, threads, messages), threads, messages);
+
+    report("binary", run_binary(threads, messages), threads, messages);
+
+    return 0;
+}
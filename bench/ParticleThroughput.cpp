@@ -0,0 +1,121 @@
+// CPU cost per frame of Particles::ParticleSystem with a million particles: the SIMD and the scalar update, the update
+// with particles expiring and being respawned every frame, and writing render instances and streaming them to a
+// RecordingBackend (no GL context needed).
+// Usage: ParticleThroughput [particles=1000000] [frames=100]
+
+#include "Particles.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr float DT = 1.0f / 60.0f;
+
+    inline auto seconds_since(Clock::time_point start) -> double
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Tops the system up to `target` particles living between `min_life` and `max_life` seconds.
+    inline auto fill(Particles::ParticleSystem &system, std::mt19937 &rng, size_t target, float min_life, float max_life) -> void
+    {
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f), life(min_life, max_life);
+        const uint32_t color = Graphics::ParticleRenderer2D::pack_color({1.0f, 0.6f, 0.2f});
+
+        while (system.size() < target)
+            system.spawn({unit(rng), unit(rng)}, {unit(rng), unit(rng)}, life(rng), 0.01f, color);
+    }
+
+    inline auto report(const char *name, double seconds, size_t particles, size_t frames) -> void
+    {
+        std::printf("%-18s %8.3f ms/frame  %6.2f ns/particle  %8.1f Mparticle/s\n", name, seconds * 1e3 / frames,
+                    seconds * 1e9 / (static_cast<double>(particles) * frames), particles * frames / seconds / 1e6);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const size_t particles = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const size_t frames = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100;
+
+    auto recording = std::make_shared<Graphics::RecordingBackend>();
+    Graphics::set_backend(recording);
+
+    std::mt19937 rng(42);
+    Particles::ParticleSystem system(particles);
+    system.set_damping(0.5f);
+
+    std::printf("%zu particles x %zu frames\n", particles, frames);
+
+    // Lifetimes far beyond the run, so only the integration is measured.
+    for (const bool simd : {false, true})
+    {
+        system.clear();
+        system.set_simd(simd);
+        fill(system, rng, particles, 1e6f, 1e6f);
+
+        const auto start = Clock::now();
+        for (size_t frame = 0; frame < frames; frame++)
+            system.update(DT);
+        report(simd ? "update (simd)" : "update (scalar)", seconds_since(start), particles, frames);
+    }
+
+    // Lifetimes of 0.1-1 s, so about 3% of the particles expire and are respawned every frame.
+    {
+        system.clear();
+        system.set_simd(true);
+        fill(system, rng, particles, 0.1f, 1.0f);
+
+        double update_seconds{0.0}, spawn_seconds{0.0};
+        size_t expired{0};
+        for (size_t frame = 0; frame < frames; frame++)
+        {
+            auto start = Clock::now();
+            system.update(DT);
+            update_seconds += seconds_since(start);
+
+            expired += particles - system.size();
+            start = Clock::now();
+            fill(system, rng, particles, 0.1f, 1.0f);
+            spawn_seconds += seconds_since(start);
+        }
+        report("update + expiry", update_seconds, particles, frames);
+        std::printf("%-18s %8.3f ms/frame  %zu expired per frame\n", "respawn", spawn_seconds * 1e3 / frames, expired / frames);
+    }
+
+    // Render preparation: instances written into a staging array (the DrawParticles payload), then one streamed draw.
+    {
+        std::vector<Particles::ParticleSystem::Instance> instances(particles);
+        Graphics::ParticleRenderer2D renderer(particles);
+
+        double write_seconds{0.0}, draw_seconds{0.0};
+        size_t draw_calls{0};
+        for (size_t frame = 0; frame < frames; frame++)
+        {
+            auto start = Clock::now();
+            system.write_instances(instances.data());
+            write_seconds += seconds_since(start);
+
+            start = Clock::now();
+            renderer.begin();
+            renderer.submit(instances.data(), system.size());
+            renderer.end();
+            draw_seconds += seconds_since(start);
+
+            draw_calls += recording->get_frame_counters().draw_calls;
+            recording->end_frame();
+        }
+        report("write instances", write_seconds, particles, frames);
+        report("stream + draw", draw_seconds, particles, frames);
+        std::printf("%-18s %8.1f per frame\n", "draw calls", static_cast<double>(draw_calls) / frames);
+    }
+
+    return 0;
+}
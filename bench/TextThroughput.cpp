@@ -0,0 +1,95 @@
+// Glyph throughput of Graphics::TextRenderer2D: laying text out into glyph instances and streaming them to the backend.
+// Runs against a RecordingBackend, so it needs no GL context and measures the CPU side only.
+// Usage: TextThroughput [glyphs per frame=100000] [frames=100]
+
+#include "Graphics.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Result
+    {
+        double submit_seconds, end_seconds;
+        size_t glyphs, draw_calls, uploaded_bytes;
+    };
+
+    // One line of printable ASCII (with a few spaces, which advance without a glyph) per 64 characters.
+    inline auto make_text(size_t characters) -> std::string
+    {
+        std::string text;
+        text.reserve(characters);
+        for (size_t i = 0; i < characters; i++)
+            text.push_back(i % 64 == 63 ? '\n' : static_cast<char>(Graphics::Font::FIRST + i % Graphics::Font::GLYPH_COUNT));
+        return text;
+    }
+
+    // Submits `text` as strings of `chunk` characters, like a HUD made of many labels.
+    inline auto run(Graphics::TextRenderer2D &renderer, Graphics::RecordingBackend &recording, const std::string &text, size_t chunk,
+                    size_t frames) -> Result
+    {
+        Result result{0.0, 0.0, 0, 0, 0};
+        const std::string_view view(text);
+
+        for (size_t frame = 0; frame < frames; frame++)
+        {
+            const auto start = Clock::now();
+            renderer.begin();
+            for (size_t i = 0; i < view.size(); i += chunk)
+                renderer.submit(view.substr(i, chunk), {-1.0f, 1.0f}, 0.01f, {1.0f, 1.0f, 1.0f});
+
+            const auto submitted = Clock::now();
+            renderer.end();
+            const auto ended = Clock::now();
+
+            result.submit_seconds += std::chrono::duration<double>(submitted - start).count();
+            result.end_seconds += std::chrono::duration<double>(ended - submitted).count();
+            result.glyphs += renderer.get_stats().glyphs;
+            result.draw_calls += recording.get_frame_counters().draw_calls;
+            result.uploaded_bytes += recording.get_frame_counters().uploaded_bytes;
+            recording.end_frame();
+        }
+
+        return result;
+    }
+
+    inline auto report(const char *name, const Result &result, size_t frames) -> void
+    {
+        const double glyphs = static_cast<double>(result.glyphs);
+        std::printf("%-14s layout: %8.2f Mglyph/s  upload: %8.2f Mglyph/s  total: %8.2f Mglyph/s (%6.2f ns/glyph)  "
+                    "%.1f draw(s) and %.1f KiB per frame\n",
+                    name, glyphs / result.submit_seconds / 1e6, glyphs / result.end_seconds / 1e6,
+                    glyphs / (result.submit_seconds + result.end_seconds) / 1e6,
+                    (result.submit_seconds + result.end_seconds) * 1e9 / glyphs,
+                    static_cast<double>(result.draw_calls) / frames, static_cast<double>(result.uploaded_bytes) / frames / 1024);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const size_t characters = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    const size_t frames = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100;
+
+    auto recording = std::make_shared<Graphics::RecordingBackend>();
+    Graphics::set_backend(recording);
+
+    const auto text = make_text(characters);
+    std::printf("%zu characters x %zu frames\n", characters, frames);
+
+    {
+        Graphics::TextRenderer2D renderer;
+        // Warm-up: grows the stream buffer and builds the vertex array outside the measured frames.
+        run(renderer, *recording, text, text.size(), 2);
+
+        report("one string", run(renderer, *recording, text, text.size(), frames), frames);
+        report("labels of 16", run(renderer, *recording, text, 16, frames), frames);
+    }
+
+    return 0;
+}
@@ -1,6 +1,15 @@
 #include "Application.hpp"
 #include "Input.hpp"
 #include "ECS.hpp"
+#include "Game.hpp"
+#include "Particles.hpp"
+#include "Scenario.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <random>
 
 /*
 #include <cmath>
@@ -142,6 +151,15 @@ int main()
 
 class AsteroidsDemo;
 
+// Frames recorded by a profile capture (F9, or "--profile" at startup).
+constexpr size_t PROFILE_CAPTURE_FRAMES = 120;
+
+// Length of a "--simulate" run given neither "--ticks" nor "--seconds": a minute of game time at 60 ticks per second.
+constexpr size_t SIMULATION_TICKS = 3600;
+
+// Length of a "--render-budget" run given neither "--ticks" nor "--seconds".
+constexpr size_t BUDGET_CHECK_TICKS = 300;
+
 class MenuLayer : public Event::AbstractLayer
 {
 
@@ -162,11 +180,17 @@ public:
             switch (event.as<KeyPressed>().key)
             {
             case Key::ESCAPE:
-                Log::info((active = not active) ? "Paused game" : "Unpaused game");
+                active = not active;
+                LOG_INFO("%s", active ? "Paused game" : "Unpaused game");
                 break;
             case Key::Q:
                 app.on_event(WindowClose());
                 break;
+#ifdef PROFILE_ENABLED
+            case Key::F9:
+                Profile::capture(PROFILE_CAPTURE_FRAMES);
+                break;
+#endif
             default:
                 break;
             }
@@ -175,16 +199,123 @@ public:
         return active && not(event.type() == Type::WindowRedraw);
     }
 
+    inline virtual auto debug_name() const -> const char * override
+    {
+        return "MenuLayer";
+    }
+
 private:
     bool active;
     App::Application &app;
 };
 
+// Bullets are recycled; this many are created up front.
+constexpr size_t BULLET_RESERVE = 64;
+
+// Asteroids at least this large split in two when shot; smaller ones are destroyed.
+constexpr float SPLIT_SCALE = 0.07f;
+
+// Fragments an asteroid can break into over its lifetime (0.15 -> 2 x 0.09 -> 4 x 0.054) are created up front.
+constexpr size_t FRAGMENT_RESERVE = 3;
+
+// Particles alive at once, e.g. thrust; spawns beyond this are dropped.
+constexpr size_t PARTICLE_CAPACITY = 1 << 14;
+
+// Longest HUD text in characters; all of it is drawn with a single draw call.
+constexpr size_t HUD_CAPACITY = 128;
+
+// Parts of GameLayer::update, timed separately for the simulation report.
+enum class System
+{
+    Ship,
+    Bullets,
+    Motion,
+    Collision,
+    Particles,
+    // Not a system, keep it last.
+    Count
+};
+
+inline auto system_name(System system) -> const char *
+{
+    switch (system)
+    {
+    case System::Ship:
+        return "Ship";
+    case System::Bullets:
+        return "Bullets";
+    case System::Motion:
+        return "Motion";
+    case System::Collision:
+        return "Collision";
+    case System::Particles:
+        return "Particles";
+    default:
+        return "None";
+    }
+}
+
 class GameLayer : public Event::AbstractLayer
 {
 public:
-    GameLayer() : app(App::Application::get_instance())
+    GameLayer(const Scenario::Config &scenario = Scenario::Config())
+        : app(App::Application::get_instance()), scenario(scenario),
+          asteroid_prefab({}, {0.0f, 0.0f, 0.0f}, {1}, {}),
+          bullet_prefab({0.0f, 0.0f, 0.0f, 0.012f}, {0.0f, 0.0f, 0.0f}, {Game::BULLET_SHAPE}, {1.0f}),
+          particles(std::max(PARTICLE_CAPACITY, scenario.particles))
     {
+        asteroid_prefab.set_recycling(true);
+        bullet_prefab.set_recycling(true);
+        particles.set_damping(0.3f);
+    }
+
+    inline virtual auto on_attach() -> void override
+    {
+        rng.seed(scenario.seed);
+
+        // Template 0 is the ship, then come irregular (but convex) asteroid outlines and the bullet.
+        shapes = Game::make_shapes(rng);
+        collisions.set_shapes(shapes);
+
+        auto ship = scene.create();
+        scene.assign<Game::Ship>(ship);
+        scene.assign<Graphics::Transform2D>(ship, 0.0f, 0.0f, 0.0f, 0.05f);
+        scene.assign<Game::Velocity>(ship, 0.0f, 0.0f, 0.0f);
+        scene.assign<Game::Shape>(ship, size_t{0});
+        auto &thrust = scene.assign<Particles::Emitter>(ship);
+        thrust.color = {1.0f, 0.6f, 0.2f};
+
+        const size_t bullets = BULLET_RESERVE + scenario.bullets;
+        const size_t entities = (1 + FRAGMENT_RESERVE) * scenario.asteroids + 1 + bullets;
+        scene.reserve_entity(entities);
+        scene.reserve_component<Graphics::Transform2D>(entities);
+        scene.reserve_component<Game::Velocity>(entities);
+        scene.reserve_component<Game::Shape>(entities);
+
+        particles.clear();
+        Scenario::populate(scenario, scene, asteroid_prefab, bullet_prefab, particles);
+        asteroid_count = scenario.asteroids;
+        bullet_count = scenario.bullets;
+
+        asteroid_prefab.reserve(scene, FRAGMENT_RESERVE * scenario.asteroids);
+        bullet_prefab.reserve(scene, BULLET_RESERVE);
+        // Every bullet and the ship may reach a few asteroids at once.
+        collisions.reserve(entities, 8 * (bullets + 1));
+
+        if (app.is_simulation_only())
+            return;
+
+        // Mesh ids match the template indices
+        auto &commands = app.get_render_queue().commands();
+        for (size_t i = 0; i < shapes.size(); i++)
+        {
+            const auto color = i == 0 || i == Game::BULLET_SHAPE ? Graphics::Color{1.0f, 1.0f, 1.0f} : Graphics::Color{0.8f, 0.8f, 0.8f};
+            const auto count = static_cast<uint32_t>(shapes[i].size());
+            auto points = commands.record<Graphics::Render::DefineMesh, Graphics::Vec2>({static_cast<uint32_t>(i), count, color}, count);
+            std::copy(shapes[i].begin(), shapes[i].end(), points);
+        }
+        mesh_instances.resize(shapes.size());
+        mesh_counts.resize(shapes.size());
     }
 
     inline virtual auto on_event(const Event::AbstractEvent &event) -> bool override
@@ -194,18 +325,16 @@ public:
         {
         case Type::AppTick:
         {
-            glClearColor(1.0, 0, 0, 1);
-            glClear(GL_COLOR_BUFFER_BIT);
-            draw();
-        }
-        break;
-
-        case Type::WindowRedraw:
-        {
+            const auto dt = static_cast<float>(event.as<AppTick>().dt);
+            update(dt);
+            if (app.is_simulation_only())
+                break;
 
             draw();
+            report(dt);
         }
         break;
+
         default:
             return false;
         }
@@ -213,35 +342,340 @@ public:
         return false;
     }
 
+    inline virtual auto debug_name() const -> const char * override
+    {
+        return "GameLayer";
+    }
+
+    inline auto get_particle_count() const -> size_t
+    {
+        return particles.size();
+    }
+
+    inline auto get_bullet_count() const -> size_t
+    {
+        return bullet_count;
+    }
+
+    inline auto get_asteroid_count() const -> size_t
+    {
+        return asteroid_count;
+    }
+
+    // Seconds spent in a system over all updates so far.
+    inline auto get_system_seconds(System system) const -> double
+    {
+        return system_seconds[static_cast<size_t>(system)];
+    }
+
 private:
-    struct Polygon
+    inline auto update(float dt) -> void
     {
-        std::shared_ptr<Graphics::VertexBuffer> vb;
-        Polygon(const std::vector<std::pair<float, float>> &data)
-            : vb(std::make_shared<Graphics::VertexBuffer>(data.data(), data.size() * sizeof(std::pair<float, float>)))
+        PROFILE_SCOPE("GameLayer::update");
+        ALLOC_SCOPE("GameLayer::update");
+        using namespace Input;
+        using Clock = std::chrono::steady_clock;
+
+        // Charges the time since the previous lap to `system`.
+        auto lap = Clock::now();
+        const auto charge = [&](System system)
         {
-            vb->set_layout({{Graphics::GLtype::Float, 2, false}});
+            const auto now = Clock::now();
+            system_seconds[static_cast<size_t>(system)] += std::chrono::duration<double>(now - lap).count();
+            lap = now;
+        };
+
+        for (auto [id, transform, velocity, ship] : scene.view<Graphics::Transform2D, Game::Velocity, Game::Ship>())
+        {
+            velocity.spin = 4.0f * (is_pressed(Key::LEFT) - is_pressed(Key::RIGHT));
+            scene.get<Particles::Emitter>(id).rate = is_pressed(Key::UP) ? 300.0f : 0.0f;
+            if (is_pressed(Key::UP))
+            {
+                velocity.x += dt * std::cos(transform.rotation);
+                velocity.y += dt * std::sin(transform.rotation);
+            }
+
+            fire_cooldown -= dt;
+            if (is_pressed(Key::SPACE) && fire_cooldown <= 0.0f)
+            {
+                fire(transform, velocity);
+                fire_cooldown = 0.15f;
+            }
         }
-    };
+        charge(System::Ship);
 
+        // Spent bullets are only deactivated, for the next shot to reuse.
+        for (auto [id, bullet] : scene.view<Game::Bullet>())
+        {
+            if ((bullet.life -= dt) <= 0.0f)
+            {
+                bullet_prefab.release(scene, id);
+                bullet_count--;
+            }
+        }
+        charge(System::Bullets);
+
+        Game::move(scene, dt);
+        charge(System::Motion);
+
+        collide();
+        charge(System::Collision);
+
+        particles.emit(scene, dt);
+        particles.update(dt);
+        charge(System::Particles);
+    }
+
+    // Bullets shatter the asteroids they hit, asteroids wreck the ship.
+    inline auto collide() -> void
+    {
+        PROFILE_SCOPE("GameLayer::collide");
+
+        // A bullet or an asteroid may be in several contacts; only its first one counts. Entities released here may
+        // be recycled by a fragment within the same loop, so contacts are filtered by body, not by entity.
+        for (const auto &contact : collisions.detect(scene))
+        {
+            if (not collisions.claim(contact))
+                continue;
+
+            const auto asteroid = collisions.entity_of(contact.a), other = collisions.entity_of(contact.b);
+
+            if (scene.has<Game::Bullet>(other))
+            {
+                bullet_prefab.release(scene, other);
+                bullet_count--;
+                shatter(asteroid);
+            }
+            else
+            {
+                auto [transform, velocity] = scene.get_all<Graphics::Transform2D, Game::Velocity>(other);
+                explode(transform, 200);
+                transform.x = transform.y = transform.rotation = 0.0f;
+                velocity = {0.0f, 0.0f, 0.0f};
+            }
+        }
+    }
+
+    // Splits a large asteroid into two smaller ones flying apart, destroys a small one.
+    inline auto shatter(ECS::EntityID id) -> void
+    {
+        auto [transform, velocity] = scene.get_all<Graphics::Transform2D, Game::Velocity>(id);
+        explode(transform, 40);
+
+        if (transform.scale < SPLIT_SCALE)
+        {
+            asteroid_prefab.release(scene, id);
+            asteroid_count--;
+            return;
+        }
+
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        const float kick_x = 0.2f * unit(rng), kick_y = 0.2f * unit(rng);
+        transform.scale *= 0.6f;
+        const auto parent = transform;
+        const Game::Velocity drift = velocity;
+        velocity = {drift.x + kick_x, drift.y + kick_y, 2.0f * unit(rng)};
+
+        // Spawning may grow the pools, so the references above are not used past this point.
+        const auto fragment = asteroid_prefab.spawn(scene);
+        auto [fragment_transform, fragment_velocity, outline] = scene.get_all<Graphics::Transform2D, Game::Velocity, Game::Shape>(fragment);
+        fragment_transform = parent;
+        fragment_velocity = {drift.x - kick_x, drift.y - kick_y, 2.0f * unit(rng)};
+        outline.index = 1 + rng() % Game::ASTEROID_SHAPES;
+        asteroid_count++;
+    }
+
+    // Debris scattered in every direction.
+    inline auto explode(const Graphics::Transform2D &at, size_t count) -> void
+    {
+        std::uniform_real_distribution<float> angle(0.0f, 6.2831853f), speed(0.1f, 0.6f), life(0.3f, 0.8f);
+        const uint32_t color = Graphics::ParticleRenderer2D::pack_color({0.9f, 0.9f, 0.8f});
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const float direction = angle(rng), velocity = speed(rng);
+            particles.spawn({at.x, at.y}, {velocity * std::cos(direction), velocity * std::sin(direction)}, life(rng), 0.008f, color);
+        }
+    }
+
+    inline auto fire(const Graphics::Transform2D &from, const Game::Velocity &velocity) -> void
+    {
+        const float cos = std::cos(from.rotation), sin = std::sin(from.rotation);
+        const float muzzle_x = from.x + cos * from.scale, muzzle_y = from.y + sin * from.scale;
+        const Game::Velocity drift = velocity;
+
+        // Spawning may grow the pools, so `from` and `velocity` are not used past this point.
+        const auto id = bullet_prefab.spawn(scene);
+        auto [transform, bullet_velocity] = scene.get_all<Graphics::Transform2D, Game::Velocity>(id);
+        transform.x = muzzle_x;
+        transform.y = muzzle_y;
+        bullet_velocity.x = drift.x + 1.5f * cos;
+        bullet_velocity.y = drift.y + 1.5f * sin;
+        bullet_count++;
+    }
+
+    // Records the frame for the render thread.
     inline auto draw() -> void
     {
+        PROFILE_SCOPE("GameLayer::draw");
+        ALLOC_SCOPE("GameLayer::draw");
+        using namespace Graphics::Render;
+
+        auto &commands = app.get_render_queue().commands();
+        const auto [width, height] = app.get_window().get_framebuffer_size();
+        const float aspect = height ? static_cast<float>(width) / height : Game::WORLD_HALF_WIDTH;
+
+        commands.record(Viewport{0, 0, width, height});
+        commands.record(SetViewProjection{Graphics::Mat4::ortho(-aspect, aspect, -1.0f, 1.0f)});
+        commands.record(Clear{{0.0f, 0.0f, 0.0f, 1.0f}});
+
+        Game::record_meshes(scene, commands, mesh_counts, mesh_instances);
+
+        if (const auto count = static_cast<uint32_t>(particles.size()))
+            particles.write_instances(commands.record<DrawParticles, Graphics::ParticleRenderer2D::Instance>({count}, count));
+
+        draw_hud(aspect);
+    }
+
+    // Formatted into a stack buffer and recorded as one DrawText, so the HUD neither allocates nor costs more than
+    // a single draw call.
+    inline auto draw_hud(float aspect) -> void
+    {
+        using namespace Graphics::Render;
+
+        const double frame_ms = app.get_window().get_frame_timings().get_last()[Graphics::FramePhase::Frame];
+        const auto stats = app.get_render_queue().get_frame_stats();
+
+        char text[HUD_CAPACITY];
+        const int length = std::snprintf(text, sizeof(text), "ASTEROIDS %zu\nFRAME %.2f MS\nDRAWS %zu UPLOAD %zu B",
+                                         asteroid_count, frame_ms, stats.draw_calls, stats.uploaded_bytes);
+        if (length <= 0)
+            return;
+
+        const auto count = static_cast<uint32_t>(std::min(static_cast<size_t>(length), sizeof(text) - 1));
+        auto out = app.get_render_queue().commands().record<DrawText, char>({{-aspect + 0.04f, 0.96f}, 0.04f, {0.4f, 1.0f, 0.4f}, count}, count);
+        std::copy(text, text + count, out);
+    }
+
+    // Periodically logs what the last frame cost the renderer.
+    inline auto report(float dt) -> void
+    {
+        if ((report_timer += dt) < 5.0f)
+            return;
+
+        report_timer = 0.0f;
+        ALLOC_EXEMPT();
+        const auto stats = app.get_render_queue().get_frame_stats();
+        LOG_DEBUG("Renderer: %zu command(s) in %zu bytes, %zu draw call(s), %zu bytes uploaded, %zu state changes issued, %zu elided",
+                  stats.commands, stats.command_bytes, stats.draw_calls, stats.uploaded_bytes, stats.state_issued, stats.state_elided);
+#ifdef ALLOC_TRACKING
+        Memory::dump();
+#endif
     }
 
     App::Application &app;
+    Scenario::Config scenario;
+    size_t asteroid_count{0};
+    ECS::Scene scene;
+    std::vector<std::vector<Graphics::Vec2>> shapes;
+    std::vector<Graphics::Transform2D *> mesh_instances;
+    std::vector<uint32_t> mesh_counts;
+    Game::AsteroidPrefab asteroid_prefab;
+    Game::BulletPrefab bullet_prefab;
+    size_t bullet_count{0};
+    float fire_cooldown{0.0f};
+    Particles::ParticleSystem particles;
+    std::mt19937 rng;
+    Game::Collisions collisions;
+    float report_timer{0.0f};
+    std::array<double, static_cast<size_t>(System::Count)> system_seconds{};
 };
 
 class AsteroidsDemo : public App::Application
 {
 public:
-    AsteroidsDemo() : App::Application::Application("Asteroids Demo")
+    AsteroidsDemo(App::Args args = App::Args()) : App::Application::Application("Asteroids Demo", args, select_platform(args))
     {
+        // "--ticks N" bounds a headless run, e.g. for soak tests and throughput benchmarks.
+        // "--asteroids N", "--bullets N" and "--particles N" set up the starting scene, "--clustered" gathers it around a
+        // few centers (see Scenario::Config) and "--seed S" makes it reproducible.
+        // "--render-budget" runs headless, for BUDGET_CHECK_TICKS unless bounded, and fails (see check_render_budget) if
+        // the last frame is over budget.
+        // "--steady-state N" reports every allocation after the first N frames (needs ALLOC_TRACKING).
+        // "--profile" captures the first frames into profile.json (needs PROFILE_ENABLED, F9 captures later ones).
+        // "--simulate" runs headless without rendering, as fast as possible, and reports the simulation's throughput
+        // (see simulate), for SIMULATION_TICKS unless bounded. "--seconds T" bounds a headless run by time, "--dt S"
+        // sets the fixed dt of its ticks.
+        scenario.seed = std::random_device{}();
+        bool bounded{false};
+        for (int i = 1; i < args.argc; i++)
+        {
+            if (std::string_view(args[i]) == "--render-budget")
+                budget_check = true;
+            else if (std::string_view(args[i]) == "--simulate")
+                set_simulation_only(true);
+            else if (std::string_view(args[i]) == "--clustered")
+                scenario.density = Scenario::Density::Clustered;
+#ifdef PROFILE_ENABLED
+            else if (std::string_view(args[i]) == "--profile")
+                Profile::capture(PROFILE_CAPTURE_FRAMES);
+#endif
+            else if (i + 1 == args.argc)
+                break;
+            else if (std::string_view(args[i]) == "--ticks")
+            {
+                window.set_tick_limit(std::strtoull(args[i + 1], nullptr, 10));
+                bounded = true;
+            }
+            else if (std::string_view(args[i]) == "--seconds")
+            {
+                window.set_time_limit(std::strtod(args[i + 1], nullptr));
+                bounded = true;
+            }
+            else if (std::string_view(args[i]) == "--dt")
+                window.set_synthetic_dt(std::strtod(args[i + 1], nullptr));
+            else if (std::string_view(args[i]) == "--asteroids")
+                scenario.asteroids = std::strtoull(args[i + 1], nullptr, 10);
+            else if (std::string_view(args[i]) == "--bullets")
+                scenario.bullets = std::strtoull(args[i + 1], nullptr, 10);
+            else if (std::string_view(args[i]) == "--particles")
+                scenario.particles = std::strtoull(args[i + 1], nullptr, 10);
+            else if (std::string_view(args[i]) == "--seed")
+                scenario.seed = static_cast<uint32_t>(std::strtoul(args[i + 1], nullptr, 10));
+#ifdef ALLOC_TRACKING
+            else if (std::string_view(args[i]) == "--steady-state")
+                Memory::set_steady_state_after(std::strtoull(args[i + 1], nullptr, 10));
+#endif
+        }
+
+        // Without a limit the run would never end, and never report.
+        if (not bounded && is_simulation_only())
+            window.set_tick_limit(SIMULATION_TICKS);
+        else if (not bounded && budget_check)
+            window.set_tick_limit(BUDGET_CHECK_TICKS);
+
         window
             .set_size(1366, 768)
             .set_aspect_constraints(16, 9)
-            .set_vsync(true);
+            .set_vsync(true)
+            .set_frame_dump_interval(5.0);
+
+        // Warm launches load linked shader programs instead of compiling them.
+        Graphics::Shader::set_binary_cache(".cache/shaders");
+
+        // Headless runs go through the real renderers, but against a backend that only counts what they would cost.
+        // Simulation-only runs have no renderers at all.
+        if (window.is_headless() && not is_simulation_only())
+        {
+            recording = std::make_shared<Graphics::RecordingBackend>();
+            recording->set_tracing(budget_check);
+            Graphics::set_backend(recording);
+        }
+        if (not is_simulation_only())
+            enable_render_queue(std::make_unique<Graphics::Render::GLExecutor>());
 
-        push_layer(new GameLayer());
+        game = new GameLayer(scenario);
+        push_layer(game);
         push_layer(new MenuLayer());
 
 #ifdef LOG_EVENTS
@@ -249,11 +683,106 @@ public:
         logger_layer->blacklist_type(Event::Type::AppTick);
         push_layer(logger_layer);
 #endif
+
+#ifdef EVT_PROFILE_LAYERS
+        get_layer_stack().set_profile_dump_interval(5.0);
+#endif
     }
+
+    // Checks the last rendered frame against what the scene should cost: one instanced draw per outline template
+    // (ship, asteroids, bullets), one for the particles and one for the HUD, one upload of every transform, particle
+    // and HUD glyph plus the frame uniforms, and a fixed number of binds. True if within budget (or not asked to check).
+    inline auto check_render_budget() -> bool
+    {
+        if (not budget_check || is_simulation_only())
+            return true;
+
+        get_render_queue().wait_idle();
+        const auto &frame = recording->get_frame_counters();
+
+        const size_t draw_budget = 1 + Game::ASTEROID_SHAPES + 1 + 1 + 1;
+        const size_t upload_budget = (game->get_asteroid_count() + 1 + game->get_bullet_count()) * sizeof(Graphics::Transform2D) + sizeof(Graphics::FrameUniforms) +
+                                     HUD_CAPACITY * sizeof(Graphics::TextRenderer2D::Glyph) +
+                                     game->get_particle_count() * sizeof(Graphics::ParticleRenderer2D::Instance);
+        const size_t state_budget = 2 * draw_budget;
+
+        LOG_INFO("Render budget: %zu/%zu draw call(s), %zu/%zu bytes uploaded, %zu/%zu state changes",
+                 frame.draw_calls, draw_budget, frame.uploaded_bytes, upload_budget, frame.state_changes, state_budget);
+
+        const bool within = frame.draw_calls <= draw_budget && frame.uploaded_bytes <= upload_budget && frame.state_changes <= state_budget;
+        if (not within)
+            recording->dump(Log::warn);
+
+        return within;
+    }
+
+    // True unless frames marked as steady-state allocated.
+    inline auto check_steady_state() const -> bool
+    {
+#ifdef ALLOC_TRACKING
+        if (Memory::get_violation_count())
+        {
+            LOG_WARN("%zu allocation(s) during steady-state frames", Memory::get_violation_count());
+            return false;
+        }
+#endif
+        return true;
+    }
+
+    // Runs until the tick or time limit (SIMULATION_TICKS by default) and logs ticks per second, the share of every system and peak memory.
+    inline auto simulate() -> void
+    {
+        using Clock = std::chrono::steady_clock;
+
+        const auto start = Clock::now();
+        run();
+        ALLOC_EXEMPT();
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        const size_t ticks = window.get_tick_count();
+
+        LOG_INFO("Simulation: %zu tick(s) of %.2f ms in %.3f s, %.0f ticks/s, %zu asteroid(s) left",
+                 ticks, window.get_synthetic_dt() * 1e3, seconds, ticks / seconds, game->get_asteroid_count());
+
+        double systems{0.0};
+        for (size_t i = 0; i < static_cast<size_t>(System::Count); i++)
+        {
+            const auto system = static_cast<System>(i);
+            const double spent = game->get_system_seconds(system);
+            systems += spent;
+            LOG_INFO("  %-10s %8.4f ms/tick %5.1f%%", system_name(system), spent * 1e3 / ticks, 100.0 * spent / seconds);
+        }
+        LOG_INFO("  %-10s %8.4f ms/tick %5.1f%%", "Other", (seconds - systems) * 1e3 / ticks, 100.0 * (seconds - systems) / seconds);
+
+        LOG_INFO("Peak RSS: %.1f MiB", Memory::get_peak_rss() / (1024.0 * 1024.0));
+    }
+
+private:
+    static inline auto select_platform(App::Args args) -> Graphics::Platform
+    {
+        for (int i = 1; i < args.argc; i++)
+        {
+            if (std::string_view(args[i]) == "--headless" || std::string_view(args[i]) == "--render-budget" ||
+                std::string_view(args[i]) == "--simulate")
+                return Graphics::Platform::Headless;
+        }
+
+        return Graphics::DEFAULT_PLATFORM;
+    }
+
+    Scenario::Config scenario;
+    GameLayer *game;
+    bool budget_check{false};
+    std::shared_ptr<Graphics::RecordingBackend> recording;
 };
 
-int main()
+int main(int argc, char **argv)
 {
-    AsteroidsDemo app;
-    app.run();
+    AsteroidsDemo app({argc, argv});
+    if (app.is_simulation_only())
+        app.simulate();
+    else
+        app.run();
+
+    const bool within_budget = app.check_render_budget();
+    return within_budget && app.check_steady_state() ? 0 : 1;
 }
\ No newline at end of file
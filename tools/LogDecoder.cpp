@@ -0,0 +1,298 @@
+// Turns a file written by Log::Binary::BinaryLogger back into text lines.
+// Usage: LogDecoder <binary log> [> output.txt]
+
+#include "BinaryLog.hpp"
+
+#include <cinttypes>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+    struct Format
+    {
+        std::string format, file;
+        uint32_t line;
+    };
+
+    struct Arg
+    {
+        Log::Binary::ArgTag tag;
+        union
+        {
+            int64_t i;
+            uint64_t u;
+            double d;
+        };
+        std::string str;
+    };
+
+    class Reader
+    {
+    public:
+        Reader(std::vector<char> data) : data(std::move(data)) {}
+
+        template <typename T>
+        inline auto get(T &value) -> bool
+        {
+            if (pos + sizeof(T) > data.size())
+                return false;
+
+            std::memcpy(&value, data.data() + pos, sizeof(T));
+            pos += sizeof(T);
+            return true;
+        }
+
+        inline auto get(std::string &str, size_t length) -> bool
+        {
+            if (pos + length > data.size())
+                return false;
+
+            str.assign(data.data() + pos, length);
+            pos += length;
+            return true;
+        }
+
+        inline auto done() const -> bool
+        {
+            return pos >= data.size();
+        }
+
+    private:
+        std::vector<char> data;
+        size_t pos{0};
+    };
+
+    // snprintf into a string of the measured length, so long string arguments are not cut off.
+    template <typename... Ts>
+    inline auto print(const std::string &format, Ts... args) -> std::string
+    {
+        const int length = std::snprintf(nullptr, 0, format.c_str(), args...);
+        if (length < 0)
+            return "<?>";
+
+        std::string out(static_cast<size_t>(length), '\0');
+        std::snprintf(out.data(), out.size() + 1, format.c_str(), args...);
+        return out;
+    }
+
+    // Bits printf reads for an integer conversion with this length modifier ("hh", "h", "l", ...).
+    inline auto modifier_bits(std::string_view modifier) -> unsigned
+    {
+        if (modifier == "hh")
+            return 8 * sizeof(char);
+        if (modifier == "h")
+            return 8 * sizeof(short);
+        if (modifier.empty())
+            return 8 * sizeof(int);
+        return 64;
+    }
+
+    // Formats a single conversion specification with the argument that was actually recorded. Integers are stored
+    // widened to 64 bits, so they are cut back to the width the length modifier names, as printf would read them.
+    inline auto format_arg(std::string spec, const Arg &arg) -> std::string
+    {
+        const char conversion = spec.back();
+        spec.pop_back();
+        const size_t modifier_begin = spec.find_last_not_of("hljztL") + 1;
+        const std::string modifier = spec.substr(modifier_begin);
+        spec.erase(modifier_begin);
+
+        const bool floating = std::string_view("fFeEgGaA").find(conversion) != std::string_view::npos;
+        const bool is_signed = arg.tag == Log::Binary::ArgTag::Int;
+
+        switch (arg.tag)
+        {
+        case Log::Binary::ArgTag::Int:
+        case Log::Binary::ArgTag::Unsigned:
+        {
+            if (conversion == 'c')
+                return print(spec + 'c', static_cast<int>(arg.u));
+            if (floating)
+                return print(spec + conversion, is_signed ? static_cast<double>(arg.i) : static_cast<double>(arg.u));
+
+            const unsigned bits = modifier_bits(modifier);
+            const uint64_t bits_value = bits < 64 ? arg.u & ((uint64_t{1} << bits) - 1) : arg.u;
+            if (std::string_view("uxXo").find(conversion) != std::string_view::npos)
+                return print(spec + "ll" + conversion, static_cast<unsigned long long>(bits_value));
+
+            // Sign-extended from the printed width
+            const int64_t value = bits < 64 ? static_cast<int64_t>(bits_value << (64 - bits)) >> (64 - bits) : arg.i;
+            return print(spec + "lld", static_cast<long long>(value));
+        }
+        case Log::Binary::ArgTag::Double:
+            if (std::string_view("fFeEgGaA").find(conversion) != std::string_view::npos)
+                return print(spec + conversion, arg.d);
+            else
+                return print(spec + 'g', arg.d);
+        case Log::Binary::ArgTag::String:
+            return print(spec + 's', arg.str.c_str());
+        case Log::Binary::ArgTag::Pointer:
+            return print("0x%" PRIx64, arg.u);
+        default:
+            return "<?>";
+        }
+    }
+
+    inline auto render(const std::string &format, const std::vector<Arg> &args) -> std::string
+    {
+        std::string out;
+        size_t next_arg{0};
+
+        for (size_t i = 0; i < format.size(); i++)
+        {
+            if (format[i] != '%')
+            {
+                out += format[i];
+                continue;
+            }
+
+            if (i + 1 < format.size() && format[i + 1] == '%')
+            {
+                out += '%';
+                i++;
+                continue;
+            }
+
+            const size_t start = i++;
+            while (i < format.size() && std::string_view("diouxXeEfFgGaAcspn").find(format[i]) == std::string_view::npos)
+                i++;
+
+            if (i == format.size())
+            {
+                out += format.substr(start);
+                break;
+            }
+
+            // A '*' width or precision was recorded as an argument of its own, ahead of the value.
+            std::string spec = format.substr(start, i - start + 1);
+            for (size_t star = spec.find('*'); star != std::string::npos && next_arg < args.size(); star = spec.find('*'))
+            {
+                const auto value = args[next_arg++].i;
+                const bool precision = star > 0 && spec[star - 1] == '.';
+
+                // A negative precision counts as none; a negative width is a '-' flag, which printing it gives.
+                if (precision && value < 0)
+                    spec.erase(star - 1, 2);
+                else
+                    spec.replace(star, 1, std::to_string(value));
+            }
+
+            if (spec.find('*') != std::string::npos || next_arg == args.size())
+            {
+                out += format.substr(start);
+                break;
+            }
+
+            out += format_arg(std::move(spec), args[next_arg++]);
+        }
+
+        return out;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <binary log>\n";
+        return 1;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (not file.is_open())
+    {
+        std::cerr << "Could not open " << argv[1] << '\n';
+        return 1;
+    }
+
+    Reader reader(std::vector<char>(std::istreambuf_iterator<char>(file), {}));
+
+    char magic[sizeof(Log::Binary::MAGIC)];
+    uint64_t steady_origin;
+    int64_t system_origin;
+    if (not(reader.get(magic) && reader.get(steady_origin) && reader.get(system_origin)) ||
+        std::memcmp(magic, Log::Binary::MAGIC, sizeof(magic)) != 0)
+    {
+        std::cerr << argv[1] << " is not a binary log\n";
+        return 1;
+    }
+
+    std::unordered_map<uint32_t, Format> formats;
+    std::vector<Arg> args;
+
+    while (not reader.done())
+    {
+        Log::Binary::RecordKind kind;
+        uint32_t id;
+        if (not(reader.get(kind) && reader.get(id)))
+            break;
+
+        if (kind == Log::Binary::RecordKind::Format)
+        {
+            Format format;
+            uint16_t format_length, file_length;
+            if (not(reader.get(format.line) && reader.get(format_length) && reader.get(file_length) &&
+                    reader.get(format.format, format_length) && reader.get(format.file, file_length)))
+                break;
+
+            formats[id] = std::move(format);
+            continue;
+        }
+
+        if (kind != Log::Binary::RecordKind::Entry)
+        {
+            std::cerr << "Corrupt record, stopping\n";
+            return 1;
+        }
+
+        uint64_t timestamp;
+        uint16_t payload;
+        std::string bytes;
+        if (not(reader.get(timestamp) && reader.get(payload) && reader.get(bytes, payload)))
+            break;
+
+        Reader payload_reader(std::vector<char>(bytes.begin(), bytes.end()));
+        args.clear();
+        while (not payload_reader.done())
+        {
+            Arg arg{};
+            if (not payload_reader.get(arg.tag))
+                break;
+
+            if (arg.tag == Log::Binary::ArgTag::String)
+            {
+                uint16_t length{0};
+                payload_reader.get(length);
+                payload_reader.get(arg.str, length);
+            }
+            else
+            {
+                payload_reader.get(arg.u);
+            }
+            args.push_back(std::move(arg));
+        }
+
+        // Map the steady clock of the record onto the wall clock captured when the file was opened.
+        const int64_t wall_ns = system_origin + static_cast<int64_t>(timestamp - steady_origin);
+        const std::time_t seconds = wall_ns / 1'000'000'000;
+        char stamp[64];
+        std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", std::localtime(&seconds));
+
+        const auto itr = formats.find(id);
+        if (itr == formats.end())
+        {
+            std::printf("[%s] <unknown format %u>\n", stamp, id);
+            continue;
+        }
+
+        std::printf("[%s.%09" PRId64 "] [%s:%u] %s\n", stamp, wall_ns % 1'000'000'000,
+                    itr->second.file.c_str(), itr->second.line, render(itr->second.format, args).c_str());
+    }
+
+    return 0;
+}